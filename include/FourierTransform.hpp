@@ -9,29 +9,82 @@
 
 #include "Common.hpp"
 
+#if defined(USE_FLOAT) && !defined(USE_FFTW)
+#error "The single precision pipeline (USE_FLOAT) requires FFTW"
+#endif
+
 #ifdef USE_FFTW
 #include <fftw3.h>
 #else
-#define FFTW_FORWARD 1
-#define FFTW_BACKWARD -1
+// Same signs as FFTW, they match the isgn argument of Ooura's cdft2d
+#define FFTW_FORWARD -1
+#define FFTW_BACKWARD 1
+// Same planner flags as FFTW (ignored by Ooura's implementation)
+#define FFTW_MEASURE (0U)
+#define FFTW_EXHAUSTIVE (1U << 3)
+#define FFTW_PATIENT (1U << 5)
+#define FFTW_ESTIMATE (1U << 6)
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #endif
 
 namespace vernier {
 
+#ifdef USE_FFTW
+    /** FFTW plan type of a given precision */
+    template<typename _Scalar> struct FFTWPlan;
+
+    template<> struct FFTWPlan<double> {
+        typedef fftw_plan Type;
+    };
+
+    template<> struct FFTWPlan<float> {
+        typedef fftwf_plan Type;
+    };
+#endif
+
     /** \brief Computes Discrete Fourier Transform on Eigen arrays using FFTW library
      * or Ooura's implementation if FFTW is not available.
+     * 
+     * Any size is supported by both implementations. Ooura's transform is 
+     * limited to powers of two, the other dimensions are computed with 
+     * Bluestein's algorithm (a circular convolution with a chirp, itself computed 
+     * with power of two transforms), which is a few times slower.
      *
      * FFT plans are prepared at the construction of the object, then the transforms 
-     * can be computed without any delays.
+     * can be computed without any delays and without any allocation (but with 
+     * FFTW for the sizes which have large prime factors, whose transforms 
+     * allocate buffers).
+     * 
+     * Real arrays can be transformed with the real-to-complex mode: only the 
+     * nRows/2+1 first rows of the spectrum are computed, the other ones being 
+     * given by the Hermitian symmetry X(-k,-l) = conj(X(k,l)).
+     * 
+     * The transform is available in double precision (FourierTransform) and, 
+     * when the library is built with USE_FLOAT, in single precision 
+     * (BasicFourierTransform<float>, linked against fftw3f).
+     * 
+     * The plans are made with FFTW_MEASURE by default. Two environment 
+     * variables allow to configure the planning without changing the code: 
+     * VERNIER_FFTW_PLANNER (estimate, measure, patient or exhaustive) sets the 
+     * default rigor, and VERNIER_FFTW_WISDOM gives a wisdom file which is 
+     * imported before the first plan and saved when the process exits (the 
+     * single precision wisdom is stored in the same file name followed by .f).
      */
-    class FourierTransform {
+    template<typename _Scalar>
+    class BasicFourierTransform {
     public:
 
+        typedef Eigen::Array<_Scalar, Eigen::Dynamic, Eigen::Dynamic> RealArray;
+        typedef Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic> ComplexArray;
+        typedef Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, 1> ComplexVector;
+
         /** Constructs the FFT plans for a given size
          *
          * \param sign: FFTW_FORWARD (default) or FFTW_BACKWARD
          */
-        FourierTransform(int sign = FFTW_FORWARD);
+        BasicFourierTransform(int sign = FFTW_FORWARD);
 
         /** Constructs the FFT plans for a given size
          *
@@ -39,7 +92,7 @@ namespace vernier {
          * \param nCols: number of cols of the array
          * \param sign: FFTW_FORWARD or FFTW_BACKWARD
          */
-        FourierTransform(int nRows, int nCols = 1, int sign = FFTW_FORWARD);
+        BasicFourierTransform(int nRows, int nCols = 1, int sign = FFTW_FORWARD);
 
         /** Constructs the FFT plans for the size of an array
          *
@@ -47,7 +100,7 @@ namespace vernier {
          * transformation is computed at this step)
          * \param sign: FFTW_FORWARD or FFTW_BACKWARD
          */
-        FourierTransform(Eigen::ArrayXXcd& array, int sign = FFTW_FORWARD);
+        BasicFourierTransform(ComplexArray& array, int sign = FFTW_FORWARD);
 
         /** Constructs the FFT plans for the size of an array
          *
@@ -55,31 +108,73 @@ namespace vernier {
          * transformation is computed at this step)
          * \param sign: FFTW_FORWARD or FFTW_BACKWARD
          */
-        FourierTransform(Eigen::ArrayXcd& array, int sign = FFTW_FORWARD);
+        BasicFourierTransform(ComplexVector& array, int sign = FFTW_FORWARD);
 
-        ~FourierTransform();
+        ~BasicFourierTransform();
 
         /** Resizes the FFT plans
          *
          * \param nRows: number of rows of the array
          * \param nCols: number of cols of the array
          * \param sign: FFTW_FORWARD or FFTW_BACKWARD
+         * \param real: true to prepare a real-to-complex (FFTW_FORWARD) or a 
+         * complex-to-real (FFTW_BACKWARD) transform, nRows and nCols being the 
+         * size of the real array
          */
-        void resize(int nRows, int nCols, int sign = FFTW_FORWARD);
+        void resize(int nRows, int nCols, int sign = FFTW_FORWARD, bool real = false);
+
+        /** Resizes the FFT plan for a batch of arrays of the same size, stored 
+         * side by side along the columns of a single array
+         *
+         * \param nRows: number of rows of each array
+         * \param nCols: number of cols of each array
+         * \param batchSize: number of arrays
+         * \param sign: FFTW_FORWARD or FFTW_BACKWARD
+         */
+        void resizeBatch(int nRows, int nCols, int batchSize, int sign = FFTW_FORWARD);
 
         /** Computes the transform using prepared FFT plan
          *
          * \param in: 2-D complex input array
          * \param out: 2-D complex output array
          */
-        void compute(const Eigen::ArrayXXcd& in, Eigen::ArrayXXcd& out);
+        void compute(const ComplexArray& in, ComplexArray& out);
 
         /** Computes the transform using prepared FFT plan
          *
          * \param in: 1-D complex input array
          * \param out: 1-D complex output array
          */
-        void compute(const Eigen::ArrayXcd& in, Eigen::ArrayXcd& out);
+        void compute(const ComplexVector& in, ComplexVector& out);
+
+        /** Computes the real-to-complex forward transform 
+         *
+         * \param in: 2-D real input array (nRows x nCols)
+         * \param out: half spectrum ((nRows/2+1) x nCols), not shifted
+         */
+        void compute(const RealArray& in, ComplexArray& out);
+
+        /** Computes the complex-to-real backward transform (unnormalized). 
+         * The transform must have been resized with the size of the real 
+         * output and the FFTW_BACKWARD sign before.
+         *
+         * \param in: half spectrum ((nRows/2+1) x nCols), not shifted
+         * \param out: 2-D real output array (nRows x nCols)
+         */
+        void compute(const ComplexArray& in, RealArray& out);
+
+        /** Computes the 2-D transforms of a batch of arrays of the same size 
+         * with a single plan (fftw_plan_many_dft)
+         *
+         * \param in: input arrays stored side by side along the columns 
+         * (nRows x batchSize*nCols, the array i starts at the column i*nCols)
+         * \param out: output arrays stored in the same way
+         * \param batchSize: number of arrays
+         */
+        void computeBatch(const ComplexArray& in, ComplexArray& out, int batchSize);
+
+        /** Returns the number of arrays transformed by the plan (1 if not batched) */
+        int getBatchSize();
         
         /** Set the direction of the FFT
          *
@@ -87,21 +182,121 @@ namespace vernier {
          */
         void setSign(int sign);
 
+        /** Sets the rigor of the planner and prepares the current plan again
+         *
+         * \param plannerFlags: FFTW_ESTIMATE, FFTW_MEASURE, FFTW_PATIENT or FFTW_EXHAUSTIVE
+         */
+        void setPlannerFlags(unsigned plannerFlags);
+
+        /** Returns the rigor of the planner */
+        unsigned getPlannerFlags();
+
+        /** Sets the number of threads used by the transform and prepares the 
+         * current plan again. With FFTW, the plan is made with 
+         * fftw_plan_with_nthreads (the library must be built with fftw3_threads), 
+         * with Ooura's implementation the 2-D row and column passes are split 
+         * between the threads.
+         *
+         * \param nThreads: number of threads (1 by default)
+         */
+        void setNumberOfThreads(int nThreads);
+
+        /** Returns the number of threads used by the transform */
+        int getNumberOfThreads();
+
+        /** Returns the planner flags corresponding to a rigor name
+         *
+         * \param rigor: "estimate", "measure", "patient" or "exhaustive"
+         */
+        static unsigned getPlannerFlags(const std::string& rigor);
+
+        /** Returns the planner flags given by the VERNIER_FFTW_PLANNER 
+         * environment variable (FFTW_MEASURE if not defined) */
+        static unsigned getDefaultPlannerFlags();
+
+        /** Imports the FFTW wisdom (previously computed plans) from a file. 
+         * Returns false if the file can't be read or without FFTW.
+         *
+         * \param filename: wisdom file
+         */
+        static bool importWisdom(const std::string& filename);
+
+        /** Exports the FFTW wisdom (all the plans computed until now) to a file. 
+         * Returns false if the file can't be written or without FFTW.
+         *
+         * \param filename: wisdom file
+         */
+        static bool exportWisdom(const std::string& filename);
+
     protected:
 
         int nRows;
         int nCols;
         int sign;
+        bool real;
+        unsigned plannerFlags;
+        int nThreads;
+        int batchSize;
+        ComplexArray buffer; // complex-to-real transforms overwrite their input
+
+        static std::string getEnvironmentWisdomFilename();
+
+        static void importEnvironmentWisdom();
+
+        static void exportEnvironmentWisdom();
 
 #ifdef USE_FFTW
-        fftw_plan plan;
+        typename FFTWPlan<_Scalar>::Type plan;
+
+        void replan();
 #else
         double** data;
         double* workArea;
         int* bitReversal;
         double* cosSinTable;
+        // Bluestein's algorithm for the dimensions which are not a power of two: 
+        // chirp exp(sign i pi k^2 / n) and spectrum of its conjugate padded to 
+        // a power of two (both empty for a power of two dimension)
+        std::vector<double> rowsChirp;
+        std::vector<double> rowsKernel;
+        std::vector<double> colsChirp;
+        std::vector<double> colsKernel;
+        // Scratch of each thread for the lines of Bluestein's algorithm, kept 
+        // between the transforms to avoid any allocation once resized
+        std::vector<std::vector<double> > lineBuffers;
+        std::vector<std::vector<double> > convolutionBuffers;
+        // Workers of the multi-threaded passes, started with the first pass 
+        // and reused by the next transforms (the calling thread computes the 
+        // first part of each pass)
+        std::vector<std::thread> workers;
+        std::mutex workersMutex;
+        std::condition_variable passStarted, passFinished;
+        int pass; // pass computed by the workers (see runPass)
+        int passCount; // number of passes started, for the workers to wait for the next one
+        int runningWorkers;
+
+        void prepareChirp(int length, std::vector<double>& chirp, std::vector<double>& kernel);
+
+        void transformLine(double* line, int length, const std::vector<double>& chirp, const std::vector<double>& kernel, std::vector<double>& convolution);
+
+        void transformColumns(int colBegin, int colEnd, int thread);
+
+        void transformRows(int rowBegin, int rowEnd, int thread);
+
+        void transformPart(int pass, int thread);
+
+        void runPass(int pass);
+
+        void runWorker(int thread, int lastPass);
+
+        void stopWorkers();
+
+        void transform(ComplexArray& array, int firstCol = 0);
 #endif
     };
+
+    /** Double precision Fourier transform */
+    typedef BasicFourierTransform<double> FourierTransform;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -42,8 +42,61 @@ namespace vernier {
          * @param array: array to apply the filter
          * @param centerRow: row for filter center
          * @param centerCol: col for filter center
+         * 
+         * The filter is available for double and float complex arrays.
          */
-        void applyTo(Eigen::ArrayXXcd& inputArray, int centerRow, int centerCol);
+        template<typename _Scalar>
+        void applyTo(Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& inputArray, int centerRow, int centerCol);
+
+        /** Applies the pre-calculated Gaussian spectral filter on a shifted 
+         * spectrum, the filtered spectrum being written in another array (zero 
+         * outside of the kernel). The spectrum is left untouched.
+         *
+         * @param spectrum: shifted spectrum
+         * @param outputArray: shifted filtered spectrum (must be sized as the spectrum)
+         * @param centerRow: row for filter center
+         * @param centerCol: col for filter center
+         */
+        template<typename _Scalar>
+        void applyTo(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& spectrum, Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& outputArray, int centerRow, int centerCol);
+
+        /** Applies the pre-calculated Gaussian spectral filter on the half spectrum of a real array.
+         * The filtered spectrum is written in the shifted full-size output array.
+         *
+         * @param halfSpectrum: unshifted half spectrum given by a real-to-complex transform
+         * @param nRows: number of rows of the full spectrum
+         * @param outputArray: shifted filtered spectrum (must be sized to the full spectrum)
+         * @param centerRow: row for filter center (in the shifted full spectrum)
+         * @param centerCol: col for filter center (in the shifted full spectrum)
+         */
+        template<typename _Scalar>
+        void applyTo(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSpectrum, int nRows, Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& outputArray, int centerRow, int centerCol);
+
+        /** Applies the pre-calculated Gaussian spectral filter on a window of a 
+         * spectrum centered on the filter. The window is written in a smaller 
+         * array, the filter center being moved to the center of this array 
+         * (i.e. to the DC of its shifted spectrum).
+         *
+         * @param spectrum: shifted spectrum
+         * @param window: filtered window (must be sized to the window size)
+         * @param centerRow: row for filter center (in the shifted spectrum)
+         * @param centerCol: col for filter center (in the shifted spectrum)
+         */
+        template<typename _Scalar>
+        void applyToWindow(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& spectrum, Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& window, int centerRow, int centerCol);
+
+        /** Applies the pre-calculated Gaussian spectral filter on a window of 
+         * the half spectrum of a real array, like applyToWindow on a full 
+         * spectrum.
+         *
+         * @param halfSpectrum: unshifted half spectrum given by a real-to-complex transform
+         * @param nRows: number of rows of the full spectrum
+         * @param window: filtered window (must be sized to the window size)
+         * @param centerRow: row for filter center (in the shifted full spectrum)
+         * @param centerCol: col for filter center (in the shifted full spectrum)
+         */
+        template<typename _Scalar>
+        void applyToWindow(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSpectrum, int nRows, Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& window, int centerRow, int centerCol);
 
         /** Changes sigma and recalculates the Gaussian spectral filter.
          *
@@ -59,6 +112,11 @@ namespace vernier {
             return kernel;
         }
 
+        /** Returns the size of the (square) kernel, outside of which the filter is zero */
+        int getKernelSize() {
+            return kernel.rows();
+        }
+
     };
 
     /** Apply gaussian spectral filter on an array without any pre-calculation (slower).
@@ -71,4 +129,4 @@ namespace vernier {
     void gaussianFilter(Eigen::ArrayXXcd& array, double centerRow, double centerCol, double sigma);
 }
 
-#endif /* GAUSSIANFILTER_HPP */
\ No newline at end of file
+#endif /* GAUSSIANFILTER_HPP */
\ No newline at end of file
@@ -26,6 +26,7 @@ namespace vernier {
         std::string date;
         std::string author;
         std::string unit;
+        Eigen::ArrayXXd imageArray; // image converted by compute, reused from one image to the next
 
         virtual void readJSON(rapidjson::Value& document);
 
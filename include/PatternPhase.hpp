@@ -13,6 +13,7 @@
 #include "FourierTransform.hpp"
 #include "RegressionPlane.hpp"
 #include "GaussianFilter.hpp"
+#include "ThreadPool.hpp"
 
 namespace vernier {
 
@@ -21,28 +22,107 @@ namespace vernier {
      * All the memory allocation and possible pre-calculations are done at the 
      * construction of the detector, then the images can be computed without any delays 
      * (but all the computed images must have the same size).
+     * 
+     * Once its buffers are sized by a first image, the computation of the 
+     * images of the same size does not allocate anything, with one or several 
+     * threads (see setNumberOfThreads). The exception is FFTW with image sizes 
+     * which have large prime factors: its transforms then allocate buffers.
      *    
      */
     class PatternPhase {
     private:
         
         RegressionPlane regressionPlane;
-        FourierTransform fft, ifft;
+        BasicFourierTransform<Real> fft, ifft;
+        BasicFourierTransform<Real> fftReal, ifftReal; // real-to-complex and complex-to-real transforms for real images
+        BasicFourierTransform<Real> fftBatch, ifftBatch; // batched transforms of computeBatch
+        BasicFourierTransform<Real> ifftDecimated; // inverse transform of the windows around the peaks
+        BasicFourierTransform<Real> fftBinned; // real-to-complex transform of the binned image of the pyramid search
         GaussianFilter gaussianFilter;
         
         double pixelPeriod;
+        double minPixelPeriod, maxPixelPeriod; // bounds of the annulus peaks search (0 if disabled)
+        std::vector<int> annulus; // coefficients of the spectrum where the peaks are searched if the bounds are set
         int peaksSearchMethod;
+        bool realSpectrum; // true if spectrum only contains the half spectrum of a real image
+        bool centeredSpectrum; // true if the complex spectrum is already centered (modulated input)
+        int nRows, nCols;
+        int maxDecimationFactor;
+        int decimationFactor; // 1 if the phase maps are computed at full resolution
+        bool tracking;
+        int trackingRadius;
+        bool trackablePlanes; // true if plane1 and plane2 can seed the peaks search of the next image
+        bool unwrapping;
+        bool fastMode; // true if the planes are computed directly from the refined peaks
+        int pyramidFactor; // binning factor of the coarse peaks search (1 if disabled)
+        int nThreads;
+        ThreadPool threadPool; // threads of the phase unwrapping
+        UnwrapBuffers unwrapBuffers;
+        bool unwrappedPhasesOutdated; // true if the unwrapped phase maps have not been computed since the planes
         
-        Eigen::ArrayXXcd spatial;  // Image of the pattern converted in complex<double> array for FFT computing
-        Eigen::ArrayXXcd spectrum, spectrumShifted;
-        Eigen::ArrayXXcd spectrumFiltered1;
-        Eigen::ArrayXXcd spectrumFiltered2;
+        // The spectral part of the computation is made in the Real precision 
+        // (float if USE_FLOAT is defined), the unwrapping and the regression in double
+        Eigen::ArrayXXd imageArray; // Image of compute(const cv::Mat&) converted in double array
+        Eigen::ArrayXXr image;     // Image of the pattern converted in Real array (USE_FLOAT only)
+        Eigen::ArrayXXcr spatial;  // Image of the pattern converted in complex<Real> array for FFT computing, modulated by (-1)^(row+col)
+        Eigen::ArrayXXcr spectrum, spectrumShifted;
+        Eigen::ArrayXXr spectrumMagnitude; // magnitude map of the half plane peaks search
+        Eigen::ArrayXXcr spectrumFiltered1;
+        Eigen::ArrayXXcr spectrumFiltered2;
         Eigen::Vector3d mainPeak1, mainPeak2;
-        Eigen::ArrayXXcd phase1, phase2;
+        Eigen::ArrayXXcr phase1, phase2;
         Eigen::ArrayXXd unwrappedPhase1, unwrappedPhase2;
+        Eigen::ArrayXXcr meanPattern;                   // zero mean pattern of computeQRCode and computeFirst
+        Eigen::ArrayXXr binnedImage;       // image binned by pyramidFactor for the coarse peaks search
+        Eigen::ArrayXXcr binnedSpectrum;   // half spectrum of the binned image
+        Eigen::ArrayXXr binnedMagnitude;   // magnitude map of the coarse peaks search
+        Eigen::RowVectorXcd peakRowPhasors, peakColumnSums; // buffers of the planes of the fast mode
         
         PhasePlane plane1, plane2;
 
+        // Patterns of computeBatch stored side by side along the columns 
+        // (the two filtered spectra of the pattern i are at 2i and 2i+1)
+        Eigen::ArrayXXcr spatialBatch, spectrumBatch;
+        Eigen::ArrayXXcr spectrumFilteredBatch, phaseBatch;
+        std::vector<PhasePlane> batchPlanes1, batchPlanes2;
+        std::vector<Eigen::Vector3d> batchPeaks1, batchPeaks2;
+
+        void updateDecimationFactor();
+
+        void updateAnnulus();
+
+        void updatePyramid();
+
+        void findPeaks();
+
+        void findPyramidPeaks(const Eigen::ArrayXXd& image);
+
+        void findPyramidPeaks(const Eigen::ArrayXXcd& image);
+
+        void searchBinnedPeaks();
+
+        bool trackPeaks();
+
+        bool searchAroundPeaks(int radius);
+
+        void filterPeaks();
+        
+        void computePlanes();
+
+        PhasePlane computePlane(Eigen::ArrayXXcr& phase, const Eigen::Vector3d& mainPeak);
+
+        void unwrapPhase(Eigen::ArrayXXcr& phase, Eigen::ArrayXXd& unwrappedPhase, const Eigen::Vector3d& mainPeak);
+
+        void updateUnwrappedPhases();
+
+        void refinePeaks(Eigen::Vector3d& refinedPeak1, Eigen::Vector3d& refinedPeak2);
+
+        void computeFastPlanes(const Eigen::ArrayXXd& image);
+
+        void computeFastPlanes(const Eigen::ArrayXXcd& image);
+
+        double gaussianResidual(double sigma);
+
     public:
         
         double MIN_PEAK_POWER = 0.00001;
@@ -65,6 +145,9 @@ namespace vernier {
         void resize(int nRows, int nCols);
 
         /** Computes the phase planes of a given pattern 
+         * 
+         * The spectrum of the real image is computed with a real-to-complex 
+         * transform, only its half is stored.
          *
          *	\param image: image of a pattern in an ArrayXXd form
          */
@@ -77,6 +160,22 @@ namespace vernier {
         void compute(const Eigen::ArrayXXcd& image);
         
         void compute(const cv::Mat& image);
+
+        /** Computes the phase planes of a batch of patterns of the same size
+         * 
+         * Each stage is applied to all the patterns before the next one: the 
+         * forward transforms, the peaks search and filtering, the backward 
+         * transforms, then the unwrapping and the regressions. The transforms 
+         * of a stage are computed with a single batched plan. The peaks of 
+         * all the patterns are searched with the pixel period known before 
+         * the batch.
+         * 
+         * The planes are given by getBatchPlane1 and getBatchPlane2, the other 
+         * getters return the results of the last pattern of the batch.
+         *
+         *	\param images: images of the patterns in an ArrayXXcd form
+         */
+        void computeBatch(const std::vector<Eigen::ArrayXXcd>& images);
         
         /** Computes the phase gradients to find the sign of the out-of-plane 
          * angles (works only with perspective projection)
@@ -116,13 +215,13 @@ namespace vernier {
         cv::Mat getImage();
 
         /** Returns the shifted spectrum */
-        Eigen::ArrayXXcd & getSpectrum();
+        Eigen::ArrayXXcr & getSpectrum();
 
         /** Returns the filtered spectrum around peak 1 */
-        Eigen::ArrayXXcd & getSpectrumPeak1();
+        Eigen::ArrayXXcr & getSpectrumPeak1();
 
         /** Returns the filtered spectrum around peak 2 */
-        Eigen::ArrayXXcd & getSpectrumPeak2();
+        Eigen::ArrayXXcr & getSpectrumPeak2();
 
         /** Returns the first unwrapped phase */
         Eigen::ArrayXXd & getUnwrappedPhase1();
@@ -141,6 +240,18 @@ namespace vernier {
 
         /** Returns the second phase plane*/
         PhasePlane getPlane2();
+
+        /** Returns the first phase plane of a pattern of the last batch
+         *
+         *	\param i: index of the pattern in the batch
+         */
+        PhasePlane getBatchPlane1(int i);
+
+        /** Returns the second phase plane of a pattern of the last batch
+         *
+         *	\param i: index of the pattern in the batch
+         */
+        PhasePlane getBatchPlane2(int i);
         
         /** Sets the ratio of pixels to crop from the border for the regression */
         void setCropFactor(double cropFactor);
@@ -166,9 +277,131 @@ namespace vernier {
         /** Returns the length of the period in pixels */
         double getPixelPeriod();
 
+        /** Restricts the peaks search to an annulus of the spectrum
+         * 
+         * When the period of the pattern and the magnification of the optics 
+         * are known within bounds, the peaks can only lie in a thin ring of 
+         * the spectrum. The indices of its coefficients are computed once for 
+         * the image size and all the peaks searches (whatever the search 
+         * method) are made on them only (see Spectrum::mainPeakAnnulus).
+         *
+         *	\param minPixelPeriod: smallest period of the pattern in pixels
+         *	\param maxPixelPeriod: largest period of the pattern in pixels
+         *	(0 and 0 to disable the restriction)
+         */
+        void setPixelPeriodBounds(double minPixelPeriod, double maxPixelPeriod);
+
+        /** Returns the smallest period in pixels of the annulus search (0 if disabled) */
+        double getMinPixelPeriod();
+
+        /** Returns the largest period in pixels of the annulus search (0 if disabled) */
+        double getMaxPixelPeriod();
+
+        /** Enables the decimated sub-band demodulation
+         * 
+         * The filtered spectrum is zero outside of the Gaussian kernel: only a 
+         * window around each peak is kept and moved to the DC, then transformed 
+         * back with a smaller inverse FFT. The phase maps are decimated by the 
+         * largest factor up to maxDecimationFactor keeping the whole kernel in 
+         * the window (the spectra and phase maps getters return the decimated 
+         * arrays). The unwrapping is made on the demodulated phase, then the 
+         * carrier is added back for the regression.
+         * 
+         * The inverse transforms and the unwrapping are faster by the square 
+         * of the factor, but the regression uses fewer pixels: the residual 
+         * fringes of the phase maps are not averaged as well with large factors.
+         *
+         *	\param maxDecimationFactor: maximal decimation factor (1 by default, 
+         *	i.e. full resolution phase maps)
+         */
+        void setDecimation(int maxDecimationFactor);
+
+        /** Returns the decimation factor of the phase maps (1 if they are computed at full resolution) */
+        int getDecimationFactor();
+
+        /** Enables the coarse-to-fine peaks search (for very large images)
+         * 
+         * The image is binned by blocks of pyramidFactor x pyramidFactor 
+         * pixels and the peaks are searched in the half plane of the small 
+         * spectrum of the binned image. Its bins are as wide as the ones of 
+         * the full spectrum, so the peaks found give the full resolution 
+         * peaks within a bin: they are then only searched in a small 
+         * neighbourhood (see Spectrum::trackPeak). The full spectrum is still 
+         * needed by the filters, but its global search is skipped. The 
+         * global search is made if the coarse peaks are too weak.
+         * 
+         * The period of the pattern must be larger than 2 pyramidFactor 
+         * pixels to be resolved in the binned image. The search is made on 
+         * the real part of the complex images. It can be combined with the 
+         * decimation of the phase maps (see setDecimation).
+         *
+         *	\param pyramidFactor: binning factor (1 by default, i.e. global 
+         *	search on the full spectrum)
+         */
+        void setPyramidFactor(int pyramidFactor);
+
+        /** Returns the binning factor of the coarse peaks search (1 if disabled) */
+        int getPyramidFactor();
+
+        /** Enables the warm-start tracking of the spectrum peaks (for videos)
+         * 
+         * The peaks are searched only in a small neighbourhood of the peaks 
+         * given by the phase planes of the previous image. The global search 
+         * is made on the first image, after a size change, or when one of the 
+         * tracked peaks is weaker than MIN_PEAK_POWER.
+         *
+         *	\param tracking: true to track the peaks (false by default)
+         *	\param radius: half size of the square neighbourhood where the peaks are searched
+         */
+        void setTracking(bool tracking, int radius = 2);
+
+        /** Returns true if the peaks are tracked between the images */
+        bool isTracking();
+
+        /** Chooses how the phase planes are estimated
+         * 
+         * With unwrapping (default), the phase maps are unwrapped and the 
+         * planes are their least squares regressions. Without unwrapping, the 
+         * planes are computed directly from the wrapped phase differences 
+         * between neighbour pixels (see RegressionPlane::computeWrapped): 
+         * there is no sequential pass and a local unwrapping error can not 
+         * propagate. In both cases, the unwrapped phase maps are only 
+         * computed when they are requested (getters, phase gradients).
+         *
+         *	\param unwrapping: false for the unwrap-free estimation
+         */
+        void setUnwrapping(bool unwrapping);
+
+        /** Returns true if the phase maps are unwrapped to estimate the planes */
+        bool isUnwrapping();
+
+        /** Enables the fast mode, for high rate coarse tracking
+         * 
+         * The peaks are refined between the bins of the spectrum and the 
+         * planes are given directly by their frequencies and by the Fourier 
+         * coefficients of the image at these frequencies (see 
+         * Spectrum::refinePeak and Spectrum::peakPlane): the filtering, the 
+         * inverse transforms, the unwrapping and the regression are skipped. 
+         * The positions are coarser (around 1e-2 pixel) and the phase maps 
+         * are not available.
+         *
+         *	\param fastMode: true for the fast mode (false by default)
+         */
+        void setFastMode(bool fastMode);
+
+        /** Returns true if the planes are computed in the fast mode */
+        bool isFastMode();
+
+        /** Sets the rigor of the FFT planner (FFTW_ESTIMATE, FFTW_MEASURE, 
+         * FFTW_PATIENT or FFTW_EXHAUSTIVE) of all the transforms */
+        void setPlannerFlags(unsigned plannerFlags);
+
+        /** Sets the number of threads of all the transforms and of the phase unwrapping */
+        void setNumberOfThreads(int nThreads);
+
         int getNRows();
 
         int getNCols();
     };
 }
-#endif // PATTERNPHASE_HPP
\ No newline at end of file
+#endif // PATTERNPHASE_HPP
\ No newline at end of file
@@ -74,6 +74,11 @@ namespace vernier {
         /** Sets the approximate length of one period in pixels */
         void setPixelPeriod(double pixelPeriod);
 
+        /** Restricts the peaks search to the periods in pixels between two 
+         * bounds, e.g. given by the physical period and the magnification range 
+         * of the optics (see PatternPhase::setPixelPeriodBounds) */
+        void setPixelPeriodBounds(double minPixelPeriod, double maxPixelPeriod);
+
         /** Sets the physical period of the pattern */
         void setPhysicalPeriod(double physicalPeriod);
 
@@ -83,6 +88,40 @@ namespace vernier {
         /** Sets the ratio of pixels to crop from the border for the regression */
         void setCropFactor(double cropFactor);
 
+        /** Sets the rigor of the FFT planner (FFTW_ESTIMATE, FFTW_MEASURE, 
+         * FFTW_PATIENT or FFTW_EXHAUSTIVE). 
+         * 
+         * FFTW_ESTIMATE gives the shortest initialization, the other flags the 
+         * fastest transforms (see also the VERNIER_FFTW_WISDOM environment 
+         * variable to save the planning between two runs).
+         */
+        void setPlannerFlags(unsigned plannerFlags);
+
+        /** Sets the number of threads used by the FFTs (useful for large images) */
+        void setNumberOfThreads(int nThreads);
+
+        /** Sets the maximal decimation factor of the phase maps (1 for full 
+         * resolution, see PatternPhase::setDecimation) */
+        void setDecimation(int maxDecimationFactor);
+
+        /** Sets the binning factor of the coarse-to-fine peaks search (1 to 
+         * disable it, see PatternPhase::setPyramidFactor) */
+        void setPyramidFactor(int pyramidFactor);
+
+        /** Enables the tracking of the spectrum peaks between successive images
+         * of a video (see PatternPhase::setTracking) */
+        void setTracking(bool tracking);
+
+        /** Chooses between the phase unwrapping (default) and the unwrap-free 
+         * estimation of the phase planes (see PatternPhase::setUnwrapping) */
+        void setUnwrapping(bool unwrapping);
+
+        /** Computes the phase planes directly from the refined spectrum peaks,
+         * without the phase maps (see PatternPhase::setFastMode). Throws an 
+         * exception if the phase gradients are computed, since they need the 
+         * phase maps (and setPhaseGradientMode throws in the fast mode). */
+        void setFastMode(bool fastMode);
+
         /** Returns the phase plane corresponding to the first direction of the pattern */
         PhasePlane getPlane1();
 
@@ -101,6 +140,10 @@ namespace vernier {
 
         bool getBool(const std::string & attribute) override;
 
+        void setString(const std::string & attribute, std::string value) override;
+
+        void setInt(const std::string & attribute, int value) override;
+
         void* getObject(const std::string & attribute) override;
 
     };
@@ -16,9 +16,12 @@ namespace vernier {
     class RegressionPlane {
     private:
         Eigen::Matrix3d matMean;
-        Eigen::ArrayXXd meshCol;
-        Eigen::ArrayXXd meshRow;
-        Eigen::ArrayXXd phaseCropped;
+        Eigen::VectorXd rowCoordinates; // coordinates of the cropped rows, relative to the center of the map
+        Eigen::VectorXd colCoordinates; // coordinates of the cropped columns, relative to the center of the map
+        Eigen::VectorXd colSums;        // sums of the cropped columns of the phase map
+        Eigen::VectorXd colRowMoments;  // sums of the cropped columns weighted by the row coordinates
+        Eigen::ArrayXcd rowPhasors, colPhasors; // demodulation of computeWrapped
+        Eigen::ArrayXd demodulatedColumn;       // scratch column of computeWrapped
         int colOffset;
         int rowOffset;
         double cropFactor;
@@ -53,9 +56,38 @@ namespace vernier {
          *
          */
         PhasePlane compute(const Eigen::ArrayXXd& unwrappedPhase);
+
+        /** Streaming interface of the regression: the phase map is given column
+         *	by column, e.g. by the unwrapping while the column is still in cache, 
+         *	and only its sums are stored. Every cropped column must be given 
+         *	(in any order, possibly by several threads) before 
+         *	computeAccumulated(). resize() must be called first with the size 
+         *	of the whole phase map.
+         *
+         *	\param col: index of the column in the cropped map
+         *	\param column: values of the column in the cropped map (getNRowsCropped() values from the row getRowOffset())
+         */
+        void accumulateColumn(int col, const double* column);
+
+        /** Computes the least square mean plane of the columns given to accumulateColumn() */
+        PhasePlane computeAccumulated();
         
         PhasePlane computeWithMask(const Eigen::ArrayXXd & unwrappedPhase, const Eigen::ArrayXXd & mask);
 
+        /** Computes the plane of a complex field of planar phase directly from 
+         *	its wrapped phase, without unwrapping. Coarse slopes are given by the
+         *	arguments of the sums of z(row, col + 1) conj(z(row, col)) and 
+         *	z(row + 1, col) conj(z(row, col)). Once demodulated by them and by its
+         *	circular mean, the phase of the field is close to zero, without wraps:
+         *	its least squares regression refines the plane. The pixels are the 
+         *	same as compute() and the plane has the same origin.
+         *
+         *	\param field: complex field (e.g. inverse transform of a filtered spectrum)
+         *	\param shifted: true if the field is modulated by (-1)^(row+col) as by Spatial::shift
+         */
+        template<typename _Scalar>
+        PhasePlane computeWrapped(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& field, bool shifted = false);
+
         /** Sets the ratio of pixels to crop from the border*/
         void setCropFactor(double cropFactor);
         
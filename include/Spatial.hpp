@@ -8,9 +8,28 @@
 #define SPATIAL_HPP
 
 #include "Common.hpp"
+#include "RegressionPlane.hpp"
+#include "ThreadPool.hpp"
 
 namespace vernier {
 
+    /** \brief Buffers of the phase unwrapping, kept between the unwrappings so 
+     * that the maps of the same size are unwrapped without any allocation
+     */
+    struct UnwrapBuffers {
+        // Seeds of the columns given by the unwrapping of the central row: the 
+        // wrapped phase and the 2PI count of the neighbour pixel of the central row,
+        // towards the center for the left half and towards the border for the right half
+        std::vector<double> centralRow;
+        std::vector<double> leftValues, rightValues;
+        std::vector<int> leftIterations, rightIterations;
+        // Column of each thread when the unwrapped phase map is not stored
+        std::vector<Eigen::VectorXd> columns;
+
+        /** Returns the number of bytes of the buffers */
+        size_t memoryFootprint();
+    };
+
     /** \brief Computes the unwrapPIng of a phase map (i.e. in [-PI;PI]) using Eigen matrixes
      *
      * The unwrapPIng is done on the same matrix as the wrapped phase. This way we only
@@ -36,14 +55,42 @@ namespace vernier {
          *		|
          *		|direction Y
          *
-         *	The algorithm unwraps first the upper halp of the phase map (i.e. quarters 1 & 2)
-         *	then it unwraps the lower half (i.e. quarters 3 & 4).
+         *	The algorithm unwraps first the central row, which gives a seed to each
+         *	column, then the columns above and below it.
          *
          *	\params wrappedPhase: Eigen matrix of the wrapped phase to be unwrapped
          * 
          */
         static void quartersUnwrapPhase(Eigen::ArrayXXd& wrappedPhase);
 
+        /** Same unwrapping as quartersUnwrapPhase(), the columns being split 
+         *	between the threads of a pool, with the same result as a single thread.
+         *	Once the buffers are sized by a first map, the maps of the same size 
+         *	are unwrapped without any allocation.
+         *
+         *	\params wrappedPhase: Eigen matrix of the wrapped phase to be unwrapped
+         *	\params buffers: buffers of the unwrapping, resized if needed
+         *	\params threadPool: threads unwrapping the columns
+         */
+        static void quartersUnwrapPhase(Eigen::ArrayXXd& wrappedPhase, UnwrapBuffers& buffers, ThreadPool& threadPool);
+
+        /** Unwraps the phase of a complex field as quartersUnwrapPhase() and 
+         *	feeds each unwrapped column to the regression while it is in cache, 
+         *	without storing the phase map: the wrapped phase is computed on the 
+         *	fly and only the pixels kept by the regression are unwrapped (the 
+         *	crop is centered, so they only depend on each other). The plane is 
+         *	then given by regressionPlane.computeAccumulated(), and is the same
+         *	as the regression of the unwrapped map.
+         *
+         *	\params field: complex field (e.g. inverse transform of a filtered spectrum)
+         *	\params shifted: true if the field is modulated by (-1)^(row+col) as by Spatial::shift
+         *	\params regressionPlane: regression accumulating the unwrapped columns
+         *	\params buffers: buffers of the unwrapping, resized if needed
+         *	\params threadPool: threads unwrapping the columns
+         */
+        template<typename _Scalar>
+        static void quartersUnwrapPhase(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& field, bool shifted, RegressionPlane& regressionPlane, UnwrapBuffers& buffers, ThreadPool& threadPool);
+
         template<typename _Scalar, int _Rows, int _Cols>
         static void shift(Eigen::Array<_Scalar, _Rows, _Cols>& array) {
             ASSERT((array.rows() % 2 == 0 && array.cols() % 2 == 0)
@@ -56,6 +103,43 @@ namespace vernier {
                 }
             }
         }
+
+        /** Copies an array (or a block) into another one of possibly different
+         * scalar type, applying on the fly the same (-1)^(row+col) modulation 
+         * as shift: the Fourier transform of the output is then directly the 
+         * shifted spectrum of the input, without any Spectrum::shift.
+         *
+         * \param input: array to be copied
+         * \param output: modulated copy (must be sized as the input)
+         */
+        template<typename _Input, typename _Output>
+        static void shift(const _Input& input, _Output& output) {
+            ASSERT(input.rows() % 2 == 0 && input.cols() % 2 == 0);
+            for (int col = 0; col < input.cols(); col++) {
+                for (int row = 0; row < input.rows(); row++) {
+                    typename _Output::Scalar value(input(row, col));
+                    output(row, col) = ((row + col) & 1) ? -value : value;
+                }
+            }
+        }
+
+        /** Computes the argument of a complex array as if it were first 
+         * modulated by shift, without modifying it. This folds the modulation
+         * into the computation of the wrapped phase.
+         *
+         * \param array: complex array (e.g. inverse transform of a shifted spectrum)
+         * \param phase: wrapped phase of the modulated array
+         */
+        template<typename _Scalar>
+        static void shiftedArg(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& array, Eigen::ArrayXXd& phase) {
+            ASSERT(array.rows() % 2 == 0 && array.cols() % 2 == 0);
+            phase.resize(array.rows(), array.cols());
+            for (int col = 0; col < array.cols(); col++) {
+                for (int row = 0; row < array.rows(); row++) {
+                    phase(row, col) = std::arg(((row + col) & 1) ? -array(row, col) : array(row, col));
+                }
+            }
+        }
     };
 }
 #endif
\ No newline at end of file
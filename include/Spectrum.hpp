@@ -18,13 +18,46 @@ namespace vernier {
     class Spectrum {
     public:
 
+        /* The spectrum methods are instantiated for complex arrays of double 
+         * (ArrayXXcd) and float (ArrayXXcf). */
+
         /** Shift a complex array to the center.
          *	The algorithm permuts blocks
          *
          *	\param source: Unshifted array (complex)
          *	\param dest: shifted array (complex)
          */
-        static void shift(Eigen::ArrayXXcd& source, Eigen::ArrayXXcd& dest);
+        template<typename _Scalar>
+        static void shift(Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& dest);
+
+        /** Rebuilds the shifted full spectrum of a real array from its half spectrum
+         *	using the Hermitian symmetry X(-k,-l) = conj(X(k,l))
+         *
+         *	\param halfSource: unshifted half spectrum ((nRows/2+1) x nCols) given by a real-to-complex transform
+         *	\param nRows: number of rows of the full spectrum
+         *	\param dest: shifted full spectrum (complex)
+         */
+        template<typename _Scalar>
+        static void shiftHermitian(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSource, int nRows, Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& dest);
+
+        /** Returns one coefficient of the shifted full spectrum of a real array from its half spectrum
+         *
+         *	\param halfSource: unshifted half spectrum ((nRows/2+1) x nCols) given by a real-to-complex transform
+         *	\param nRows: number of rows of the full spectrum
+         *	\param row: row of the coefficient in the shifted full spectrum
+         *	\param col: col of the coefficient in the shifted full spectrum
+         */
+        template<typename _Scalar>
+        static inline std::complex<_Scalar> hermitianValue(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSource, int nRows, int row, int col) {
+            int nCols = halfSource.cols();
+            int unshiftedRow = (row + nRows - nRows / 2) % nRows;
+            int unshiftedCol = (col + nCols - nCols / 2) % nCols;
+            if (unshiftedRow < halfSource.rows()) {
+                return halfSource(unshiftedRow, unshiftedCol);
+            } else {
+                return std::conj(halfSource(nRows - unshiftedRow, (nCols - unshiftedCol) % nCols));
+            }
+        }
 
         /** Search the main peak of the spectrum to prepare for the inverse Fourier transfrom
          *	and where to apply the hypergaussian filter
@@ -37,7 +70,8 @@ namespace vernier {
          *	\param mainPeak2: vector containing the second local maximum (located in the next quadrant of the spectrum)
          *	\param approxPixelPeriod: approximate pixelic period of the pattern, the search of the two maximums is bound in a $[\lambda_{px} - \sqrt{2}\cdot \lambda_{px}; \lambda_{px} + \sqrt{2}\cdot \lambda_{px}]$ interval
          */
-        static void mainPeakCircle(Eigen::ArrayXXcd& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2, double approxPixelPeriod);
+        template<typename _Scalar>
+        static void mainPeakCircle(Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2, double approxPixelPeriod);
 
 
         /** Search the main peak of the spectrum to prepare for the inverse Fourier transfrom
@@ -50,19 +84,26 @@ namespace vernier {
          *	\param mainPeak1: vector containing one local maximum (located in one quadrant of the spectrum)
          *	\param mainPeak2: vector containing the second local maximum (located in the next quadrant of the spectrum)
          */
-        static void mainPeakQuarter(Eigen::ArrayXXcd& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2);
+        template<typename _Scalar>
+        static void mainPeakQuarter(Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2);
 
 
         /** Search the main peak of the spectrum to prepare for the inverse Fourier transfrom
          *	and where to apply the hypergaussian filter
          *
-         *	Documentation tbd
+         *	The eight peaks are the ones of the former iterative search (maximum 
+         *	of the power, then zeroing of an 8x8 block around it), selected in a 
+         *	single scan (fixed size heap), sorted by angle around the center and 
+         *	paired by distances. Unlike the former search, the spectrum is not 
+         *	modified, and the missing peaks of a spectrum with too few nonzero 
+         *	coefficients are set at its center instead of being undefined.
          *
          *	\param source: complex array where the search is made
          *	\param mainPeak1: vector containing one local maximum (located in one quadrant of the spectrum)
          *	\param mainPeak2: vector containing the second local maximum (located in the next quadrant of the spectrum)
          */
-        static void mainPeakPerimeter(Eigen::ArrayXXcd& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2);
+        template<typename _Scalar>
+        static void mainPeakPerimeter(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2);
 
 
         /** Search the main peak of the spectrum to prepare for the inverse Fourier transfrom
@@ -78,20 +119,157 @@ namespace vernier {
          *	\param frequencyMin: same as frequencyMin, except frequencyMax = cols/pixelPeriodMax
          *	\param frequencyMin: lower bound of the spectral ring to search the main peak of the spectrum
          *	\param frequencyMax: upper bound of the spectral ring to search the main peak of the spectrum
+         *
+         *	The magnitude of the searched half plane is computed once in a map, 
+         *	the sums of the magnitudes of each coefficient and its four neighbours 
+         *	are computed column by column, and the neighbourhoods of the center 
+         *	and of the first peak are excluded in the map: the spectrum is not modified.
+         *
+         *	\param magnitude: magnitude map of the search, resized if needed (reused between calls to avoid allocations)
+         */
+        template<typename _Scalar>
+        static void mainPeakHalfPlane(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Array<_Scalar, Eigen::Dynamic, Eigen::Dynamic>& magnitude, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2);
+
+        /** Same search as above with a temporary magnitude map. */
+        template<typename _Scalar>
+        static void mainPeakHalfPlane(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2);
+
+        /** Same search as mainPeakHalfPlane() made directly on the half spectrum of a real array.
+         *	The peaks are returned in the coordinates of the shifted full spectrum.
+         *
+         *	\param halfSource: unshifted half spectrum ((nRows/2+1) x nCols) given by a real-to-complex transform
+         *	\param nRows: number of rows of the full spectrum
+         *	\param magnitude: magnitude map of the search, resized if needed
+         *	\param mainPeak1: vector containing one local maximum (located in one quadrant of the spectrum)
+         *	\param mainPeak2: vector containing the second local maximum (located in the next quadrant of the spectrum)
+         */
+        template<typename _Scalar>
+        static void mainPeakHalfPlane(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSource, int nRows, Eigen::Array<_Scalar, Eigen::Dynamic, Eigen::Dynamic>& magnitude, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2);
+
+        /** Same search as above with a temporary magnitude map. */
+        template<typename _Scalar>
+        static void mainPeakHalfPlane(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSource, int nRows, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2);
+
+        /** Lists the coefficients of the searched half plane of the shifted 
+         *	spectrum (see mainPeakHalfPlane()) whose period lies between two 
+         *	bounds, i.e. an annulus around the center of the spectrum.
+         *
+         *	\param nRows: number of rows of the full spectrum
+         *	\param nCols: number of columns of the full spectrum
+         *	\param minPixelPeriod: smallest period in pixels (outer radius of the annulus)
+         *	\param maxPixelPeriod: largest period in pixels (inner radius of the annulus)
+         *	\param indices: column-major indices (col * nRows + row) of the coefficients of the annulus
+         */
+        static void annulusIndices(int nRows, int nCols, double minPixelPeriod, double maxPixelPeriod, std::vector<int>& indices);
+
+        /** Same search as mainPeakHalfPlane() restricted to the coefficients of 
+         *	an annulus given by annulusIndices(). The spectrum is not modified.
+         *
+         *	\param source: shifted spectrum where the search is made
+         *	\param annulus: indices of the coefficients of the annulus
+         *	\param mainPeak1: vector containing one local maximum (located in one quadrant of the spectrum)
+         *	\param mainPeak2: vector containing the second local maximum (located in the next quadrant of the spectrum)
+         */
+        template<typename _Scalar>
+        static void mainPeakAnnulus(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, const std::vector<int>& annulus, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2);
+
+        /** Same search as mainPeakAnnulus() made directly on the half spectrum of a real array.
+         *
+         *	\param halfSource: unshifted half spectrum ((nRows/2+1) x nCols) given by a real-to-complex transform
+         *	\param nRows: number of rows of the full spectrum
+         *	\param annulus: indices of the coefficients of the annulus in the shifted full spectrum
+         *	\param mainPeak1: vector containing one local maximum (located in one quadrant of the spectrum)
+         *	\param mainPeak2: vector containing the second local maximum (located in the next quadrant of the spectrum)
+         */
+        template<typename _Scalar>
+        static void mainPeakAnnulus(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSource, int nRows, const std::vector<int>& annulus, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2);
+
+        /** Refines the position of a peak between the bins of the spectrum 
+         *	(Jacobsen interpolation with the bias correction of Candan, along 
+         *	the rows and along the columns through the peak).
+         *
+         *	\param source: shifted spectrum
+         *	\param peak: peak found on the bins (x = col, y = row), replaced by its refined position
+         */
+        template<typename _Scalar>
+        static void refinePeak(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Vector3d& peak);
+
+        /** Same refinement as refinePeak() made directly on the half spectrum of a real array.
+         *
+         *	\param halfSource: unshifted half spectrum ((nRows/2+1) x nCols) given by a real-to-complex transform
+         *	\param nRows: number of rows of the full spectrum
+         *	\param peak: peak position in the shifted full spectrum, replaced by its refined position
+         */
+        template<typename _Scalar>
+        static void refinePeak(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSource, int nRows, Eigen::Vector3d& peak);
+
+        /** Returns the phase plane of a periodic pattern directly from a refined 
+         *	peak of its spectrum: the slopes are given by the frequency of the 
+         *	peak and the phase at the center of the image by the Fourier 
+         *	coefficient of the image at this frequency (single-bin DFT).
+         *
+         *	\param image: image of the pattern (not modulated)
+         *	\param peak: refined position of the peak in the shifted spectrum (see refinePeak())
+         */
+        static PhasePlane peakPlane(const Eigen::ArrayXXd& image, const Eigen::Vector3d& peak);
+
+        /** Same as above for a complex image */
+        static PhasePlane peakPlane(const Eigen::ArrayXXcd& image, const Eigen::Vector3d& peak);
+
+        /** Same as peakPlane() with buffers given by the caller, so that a 
+         *	repeated computation does not allocate.
+         *
+         *	\param image: image of the pattern (not modulated)
+         *	\param peak: refined position of the peak in the shifted spectrum (see refinePeak())
+         *	\param rowPhasors: buffer of the phasors of the rows, resized if needed
+         *	\param columnSums: buffer of the weighted sums of the columns, resized if needed
+         */
+        static PhasePlane peakPlane(const Eigen::ArrayXXd& image, const Eigen::Vector3d& peak, Eigen::RowVectorXcd& rowPhasors, Eigen::RowVectorXcd& columnSums);
+
+        /** Same as above for a complex image */
+        static PhasePlane peakPlane(const Eigen::ArrayXXcd& image, const Eigen::Vector3d& peak, Eigen::RowVectorXcd& rowPhasors, Eigen::RowVectorXcd& columnSums);
+
+        /** Searches a peak only in a small neighbourhood of its expected position
+         *	(e.g. the peak found in the previous frame of a video), with the same
+         *	criterion and in the same half plane as mainPeakHalfPlane().
+         *	The spectrum is not modified.
+         *
+         *	\param source: shifted spectrum where the search is made
+         *	\param peak: expected peak position (x = col, y = row), replaced by the peak found (z = peak power)
+         *	\param radius: half size of the square neighbourhood where the peak is searched
+         */
+        template<typename _Scalar>
+        static void trackPeak(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Vector3d& peak, int radius);
+
+        /** Same search as trackPeak() made directly on the half spectrum of a real array.
+         *
+         *	\param halfSource: unshifted half spectrum ((nRows/2+1) x nCols) given by a real-to-complex transform
+         *	\param nRows: number of rows of the full spectrum
+         *	\param peak: expected peak position in the shifted full spectrum, replaced by the peak found
+         *	\param radius: half size of the square neighbourhood where the peak is searched
          */
-        static void mainPeakHalfPlane(Eigen::ArrayXXcd& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2);
+        template<typename _Scalar>
+        static void trackPeak(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSource, int nRows, Eigen::Vector3d& peak, int radius);
 
 
         /** Search the main peak of the spectrum to prepare for the inverse Fourier transfrom
          *	and where to apply the hypergaussian filter
          *
-         *	Documentation tbd
+         *	The ten peaks are the ones of the former iterative search (maximum 
+         *	of the power, then zeroing of an 8x8 block around it), selected in a 
+         *	single scan (fixed size heap). The four strongest ones (magnitude of a 
+         *	2x2 block) are sorted by angle around the center to choose the pair. 
+         *	Unlike the former search, the spectrum is not modified (it was left 
+         *	divided by 50 with its center zeroed), and the missing peaks of a 
+         *	spectrum with too few nonzero coefficients are set at its center 
+         *	instead of being undefined.
          *
          *	\param source: complex array where the search is made
          *	\param mainPeak1: vector containing one local maximum (located in one quadrant of the spectrum)
          *	\param mainPeak2: vector containing the second local maximum (located in the next quadrant of the spectrum)
          */
-        static void mainPeak4Search(Eigen::ArrayXXcd& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2);
+        template<typename _Scalar>
+        static void mainPeak4Search(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2);
 
         static double getDistancePoints(double x1, double y1, double x2, double y2);
 
@@ -99,4 +277,4 @@ namespace vernier {
     };
 }
 
-#endif // !SPECTRUM_HPP
\ No newline at end of file
+#endif // !SPECTRUM_HPP
\ No newline at end of file
@@ -18,6 +18,7 @@ namespace vernier {
     protected:
 
         Eigen::ArrayXXcd snapshot;
+        std::vector<Eigen::ArrayXXcd> snapshots; // snapshots of all the detected stampss, computed as a batch
         int numberHalfPeriods;
         int snapshotSize;
         
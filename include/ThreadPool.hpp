@@ -0,0 +1,81 @@
+/* 
+ * This file is part of the VERNIER Library.
+ *
+ * Copyright (c) 2018-2025 CNRS, ENSMM, UMLP.
+ */
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace vernier {
+
+    /** \brief Runs loops split in one part per thread on persistent threads
+     *
+     * The workers are started by the first loop and reused by the next ones, 
+     * so that a loop neither creates threads nor allocates anything. The 
+     * calling thread computes the first part of each loop. A copy of a pool 
+     * has the same number of threads but its own workers.
+     */
+    class ThreadPool {
+    private:
+        int nThreads;
+        std::vector<std::thread> workers;
+        std::mutex workersMutex;
+        std::condition_variable loopStarted, loopFinished;
+        int loopCount; // number of loops started, a new value wakes up the workers
+        int runningWorkers;
+        bool stopping;
+        // Loop being run, called through a function of its type
+        void (*partRunner)(const void* function, int part, int nParts);
+        const void* function;
+
+        template<typename _Function>
+        static void runPart(const void* function, int part, int nParts) {
+            (*(const _Function*) function)(part, nParts);
+        }
+
+        void runLoop(void (*partRunner)(const void*, int, int), const void* function);
+
+        void runWorker(int part, int lastLoop);
+
+        void stopWorkers();
+
+    public:
+
+        /** Constructs a pool of a given number of threads (the workers are 
+         *	started by the first loop) */
+        ThreadPool(int nThreads = 1);
+
+        ThreadPool(const ThreadPool& pool);
+
+        ThreadPool& operator=(const ThreadPool& pool);
+
+        ~ThreadPool();
+
+        /** Sets the number of threads (the calling thread included) */
+        void setNumberOfThreads(int nThreads);
+
+        /** Returns the number of threads */
+        int getNumberOfThreads();
+
+        /** Calls function(part, nParts) for each part of [0, nParts[ where 
+         *	nParts is the number of threads, each part on its own thread, and 
+         *	returns once they are all done. The function must not throw.
+         */
+        template<typename _Function>
+        void run(const _Function& function) {
+            if (nThreads == 1) {
+                function(0, 1);
+            } else {
+                runLoop(runPart<_Function>, &function);
+            }
+        }
+    };
+}
+
+#endif
@@ -9,8 +9,21 @@
 
 #include "Common.hpp"
 
+namespace vernier {
+
+    /** Floating point type of the phase computation (single precision if the 
+     * library is built with USE_FLOAT) */
+#ifdef USE_FLOAT
+    typedef float Real;
+#else
+    typedef double Real;
+#endif
+}
+
 namespace Eigen {
     typedef Array< unsigned char, Dynamic, Dynamic > ArrayXXu;
+    typedef Array< vernier::Real, Dynamic, Dynamic > ArrayXXr;
+    typedef Array< std::complex<vernier::Real>, Dynamic, Dynamic > ArrayXXcr;
 }
 
 namespace vernier {
@@ -31,8 +44,17 @@ namespace vernier {
 
     cv::Mat array2image(const Eigen::ArrayXXcd & array);
 
+    cv::Mat array2image(const Eigen::ArrayXXf & array);
+
+    cv::Mat array2image(const Eigen::ArrayXXcf & array);
+
     Eigen::ArrayXXd image2array(const cv::Mat & image);
 
+    /** Converts an image into an array normalized in [0, 1] (same values as the
+     * other image2array) reusing the memory of the array: a gray level image of 
+     * the size of the array is converted without any allocation. */
+    void image2array(const cv::Mat & image, Eigen::ArrayXXd & array);
+
     void imageTo8UC1(const cv::Mat& image, cv::Mat& grayscaleImage);
 
     void arrayShow(const std::string windowTitle, const Eigen::ArrayXXd & array);
@@ -51,4 +73,4 @@ namespace vernier {
 
 #define PRINT(variable) { std::cout << "  "<< #variable << " at line " << __LINE__ << " = " << variable << std::endl; }
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
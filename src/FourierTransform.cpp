@@ -5,106 +5,497 @@
  */
 
 #include "FourierTransform.hpp"
+#include <thread>
+#include <cstdlib>
 
 namespace vernier {
+
+    template<typename _Scalar>
+    unsigned BasicFourierTransform<_Scalar>::getPlannerFlags(const std::string& rigor) {
+        if (rigor == "estimate") {
+            return FFTW_ESTIMATE;
+        } else if (rigor == "measure") {
+            return FFTW_MEASURE;
+        } else if (rigor == "patient") {
+            return FFTW_PATIENT;
+        } else if (rigor == "exhaustive") {
+            return FFTW_EXHAUSTIVE;
+        } else {
+            throw Exception("Unknown FFTW planner rigor " + rigor + " (estimate, measure, patient or exhaustive expected).");
+        }
+    }
+
+    template<typename _Scalar>
+    unsigned BasicFourierTransform<_Scalar>::getDefaultPlannerFlags() {
+        const char* rigor = getenv("VERNIER_FFTW_PLANNER");
+        if (rigor == NULL) {
+            return FFTW_MEASURE;
+        }
+        return getPlannerFlags(rigor);
+    }
+
+    template<typename _Scalar>
+    std::string BasicFourierTransform<_Scalar>::getEnvironmentWisdomFilename() {
+        const char* filename = getenv("VERNIER_FFTW_WISDOM");
+        if (filename == NULL) {
+            return "";
+        }
+        // FFTW keeps separate wisdom for each precision
+        return std::string(filename) + (sizeof (_Scalar) == sizeof (float) ? ".f" : "");
+    }
+
+    template<typename _Scalar>
+    void BasicFourierTransform<_Scalar>::importEnvironmentWisdom() {
+        static bool imported = false;
+        if (!imported) {
+            imported = true;
+            std::string filename = getEnvironmentWisdomFilename();
+            if (!filename.empty()) {
+                importWisdom(filename);
+                // The wisdom is saved once when the process exits, not after 
+                // each plan (file I/O while planning, and concurrent writes 
+                // of the processes sharing the file)
+                std::atexit(exportEnvironmentWisdom);
+            }
+        }
+    }
+
+    template<typename _Scalar>
+    void BasicFourierTransform<_Scalar>::exportEnvironmentWisdom() {
+        std::string filename = getEnvironmentWisdomFilename();
+        if (!filename.empty()) {
+            exportWisdom(filename);
+        }
+    }
+
+    template<typename _Scalar>
+    unsigned BasicFourierTransform<_Scalar>::getPlannerFlags() {
+        return plannerFlags;
+    }
+
+    template<typename _Scalar>
+    int BasicFourierTransform<_Scalar>::getNumberOfThreads() {
+        return nThreads;
+    }
+
+    template<typename _Scalar>
+    int BasicFourierTransform<_Scalar>::getBatchSize() {
+        return batchSize;
+    }
+
 #ifdef USE_FFTW
 
-    FourierTransform::FourierTransform(int sign) {
+    // Overloads calling the FFTW functions of the right precision
+
+    static inline fftw_plan planDft1d(int n, std::complex<double>* in, std::complex<double>* out, int sign, unsigned flags) {
+        return fftw_plan_dft_1d(n, (fftw_complex*) in, (fftw_complex*) out, sign, flags);
+    }
+
+    static inline fftwf_plan planDft1d(int n, std::complex<float>* in, std::complex<float>* out, int sign, unsigned flags) {
+        return fftwf_plan_dft_1d(n, (fftwf_complex*) in, (fftwf_complex*) out, sign, flags);
+    }
+
+    static inline fftw_plan planDft2d(int n0, int n1, std::complex<double>* in, std::complex<double>* out, int sign, unsigned flags) {
+        return fftw_plan_dft_2d(n0, n1, (fftw_complex*) in, (fftw_complex*) out, sign, flags);
+    }
+
+    static inline fftwf_plan planDft2d(int n0, int n1, std::complex<float>* in, std::complex<float>* out, int sign, unsigned flags) {
+        return fftwf_plan_dft_2d(n0, n1, (fftwf_complex*) in, (fftwf_complex*) out, sign, flags);
+    }
+
+    static inline fftw_plan planManyDft2d(int n0, int n1, int howMany, std::complex<double>* in, std::complex<double>* out, int sign, unsigned flags) {
+        int n[] = {n0, n1};
+        return fftw_plan_many_dft(2, n, howMany, (fftw_complex*) in, NULL, 1, n0 * n1, (fftw_complex*) out, NULL, 1, n0 * n1, sign, flags);
+    }
+
+    static inline fftwf_plan planManyDft2d(int n0, int n1, int howMany, std::complex<float>* in, std::complex<float>* out, int sign, unsigned flags) {
+        int n[] = {n0, n1};
+        return fftwf_plan_many_dft(2, n, howMany, (fftwf_complex*) in, NULL, 1, n0 * n1, (fftwf_complex*) out, NULL, 1, n0 * n1, sign, flags);
+    }
+
+    static inline fftw_plan planDftR2c2d(int n0, int n1, double* in, std::complex<double>* out, unsigned flags) {
+        return fftw_plan_dft_r2c_2d(n0, n1, in, (fftw_complex*) out, flags);
+    }
+
+    static inline fftwf_plan planDftR2c2d(int n0, int n1, float* in, std::complex<float>* out, unsigned flags) {
+        return fftwf_plan_dft_r2c_2d(n0, n1, in, (fftwf_complex*) out, flags);
+    }
+
+    static inline fftw_plan planDftC2r2d(int n0, int n1, std::complex<double>* in, double* out, unsigned flags) {
+        return fftw_plan_dft_c2r_2d(n0, n1, (fftw_complex*) in, out, flags);
+    }
+
+    static inline fftwf_plan planDftC2r2d(int n0, int n1, std::complex<float>* in, float* out, unsigned flags) {
+        return fftwf_plan_dft_c2r_2d(n0, n1, (fftwf_complex*) in, out, flags);
+    }
+
+    static inline void executeDft(fftw_plan plan, const std::complex<double>* in, std::complex<double>* out) {
+        fftw_execute_dft(plan, (fftw_complex*) in, (fftw_complex*) out);
+    }
+
+    static inline void executeDft(fftwf_plan plan, const std::complex<float>* in, std::complex<float>* out) {
+        fftwf_execute_dft(plan, (fftwf_complex*) in, (fftwf_complex*) out);
+    }
+
+    static inline void executeDftR2c(fftw_plan plan, const double* in, std::complex<double>* out) {
+        fftw_execute_dft_r2c(plan, (double*) in, (fftw_complex*) out);
+    }
+
+    static inline void executeDftR2c(fftwf_plan plan, const float* in, std::complex<float>* out) {
+        fftwf_execute_dft_r2c(plan, (float*) in, (fftwf_complex*) out);
+    }
+
+    static inline void executeDftC2r(fftw_plan plan, std::complex<double>* in, double* out) {
+        fftw_execute_dft_c2r(plan, (fftw_complex*) in, out);
+    }
+
+    static inline void executeDftC2r(fftwf_plan plan, std::complex<float>* in, float* out) {
+        fftwf_execute_dft_c2r(plan, (fftwf_complex*) in, out);
+    }
+
+    static inline void destroyPlan(fftw_plan plan) {
+        fftw_destroy_plan(plan);
+    }
+
+    static inline void destroyPlan(fftwf_plan plan) {
+        fftwf_destroy_plan(plan);
+    }
+
+    // Number of threads of the next plans, for the right precision
+    template<typename _Scalar>
+    static inline void planWithNThreads(int nThreads);
+
+    template<>
+    inline void planWithNThreads<double>(int nThreads) {
+#ifdef USE_FFTW_THREADS
+        static bool initialized = (fftw_init_threads() != 0);
+        if (initialized) {
+            fftw_plan_with_nthreads(nThreads);
+        }
+#else
+        (void) nThreads;
+#endif
+    }
+
+    template<>
+    inline void planWithNThreads<float>(int nThreads) {
+#if defined(USE_FFTW_THREADS) && defined(USE_FLOAT)
+        static bool initialized = (fftwf_init_threads() != 0);
+        if (initialized) {
+            fftwf_plan_with_nthreads(nThreads);
+        }
+#else
+        (void) nThreads;
+#endif
+    }
+
+    template<>
+    bool BasicFourierTransform<double>::importWisdom(const std::string& filename) {
+        return fftw_import_wisdom_from_filename(filename.c_str()) != 0;
+    }
+
+    template<>
+    bool BasicFourierTransform<double>::exportWisdom(const std::string& filename) {
+        return fftw_export_wisdom_to_filename(filename.c_str()) != 0;
+    }
+
+#ifdef USE_FLOAT
+    template<>
+    bool BasicFourierTransform<float>::importWisdom(const std::string& filename) {
+        return fftwf_import_wisdom_from_filename(filename.c_str()) != 0;
+    }
+
+    template<>
+    bool BasicFourierTransform<float>::exportWisdom(const std::string& filename) {
+        return fftwf_export_wisdom_to_filename(filename.c_str()) != 0;
+    }
+#endif
+
+    template<typename _Scalar>
+    BasicFourierTransform<_Scalar>::BasicFourierTransform(int sign) {
         plan = NULL;
         nRows = 0;
         nCols = 0;
         this -> sign = sign;
+        real = false;
+        plannerFlags = getDefaultPlannerFlags();
+        nThreads = 1;
+        batchSize = 1;
     }
 
-    FourierTransform::FourierTransform(int rows, int cols, int sign) : FourierTransform() {
+    template<typename _Scalar>
+    BasicFourierTransform<_Scalar>::BasicFourierTransform(int rows, int cols, int sign) : BasicFourierTransform() {
         resize(rows, cols, sign);
     }
 
-    FourierTransform::FourierTransform(Eigen::ArrayXXcd& array, int sign) : FourierTransform() {
+    template<typename _Scalar>
+    BasicFourierTransform<_Scalar>::BasicFourierTransform(ComplexArray& array, int sign) : BasicFourierTransform() {
         resize(array.rows(), array.cols(), sign);
     }
 
-    FourierTransform::FourierTransform(Eigen::ArrayXcd& array, int sign) : FourierTransform() {
+    template<typename _Scalar>
+    BasicFourierTransform<_Scalar>::BasicFourierTransform(ComplexVector& array, int sign) : BasicFourierTransform() {
         resize(array.rows(), array.cols(), sign);
     }
 
-    FourierTransform::~FourierTransform() {
+    template<typename _Scalar>
+    BasicFourierTransform<_Scalar>::~BasicFourierTransform() {
         if (plan != NULL) {
-            fftw_destroy_plan(plan);
+            destroyPlan(plan);
         }
     }
 
-    void FourierTransform::resize(int nRows, int nCols, int sign) {
+    template<typename _Scalar>
+    void BasicFourierTransform<_Scalar>::resize(int nRows, int nCols, int sign, bool real) {
         if (nRows <= 0 || nCols <= 0) {
             throw Exception("Can't resize a FourierTransform with rows<=0 or cols<=0");
-        } else if (nRows != this->nRows || nCols != this->nCols || sign != this->sign) {
+        } else if (nRows != this->nRows || nCols != this->nCols || sign != this->sign || real != this->real || batchSize != 1) {
             if (plan != NULL) {
-                fftw_destroy_plan(plan);
+                destroyPlan(plan);
             }
 
             this->nRows = nRows;
             this->nCols = nCols;
             this->sign = sign;
+            this->real = real;
+            this->batchSize = 1;
 
-            fftw_complex* in = (fftw_complex*) fftw_malloc(sizeof (fftw_complex) * nRows * nCols);
-            fftw_complex* out = (fftw_complex*) fftw_malloc(sizeof (fftw_complex) * nRows * nCols);
+            importEnvironmentWisdom();
+            planWithNThreads<_Scalar>(nThreads);
+            // Without buffering, the executions of the plans allocate nothing 
+            // (but for the sizes with large prime factors)
+            unsigned flags = plannerFlags | FFTW_NO_BUFFERING;
 
-            if (nRows == 1 || nCols == 1) {
-                plan = fftw_plan_dft_1d(nRows * nCols, in, out, sign, FFTW_MEASURE);
+            if (real) {
+                // Eigen is column major: the halved dimension of FFTW (the last one) is the rows
+                _Scalar* realData = (_Scalar*) fftw_malloc(sizeof (_Scalar) * nRows * nCols);
+                std::complex<_Scalar>* complexData = (std::complex<_Scalar>*) fftw_malloc(sizeof (std::complex<_Scalar>) * (nRows / 2 + 1) * nCols);
+
+                if (sign == FFTW_FORWARD) {
+                    plan = planDftR2c2d(nCols, nRows, realData, complexData, flags);
+                } else {
+                    plan = planDftC2r2d(nCols, nRows, complexData, realData, flags);
+                }
+
+                fftw_free(realData);
+                fftw_free(complexData);
             } else {
-                plan = fftw_plan_dft_2d(nCols, nRows, in, out, sign, FFTW_MEASURE);
+                std::complex<_Scalar>* in = (std::complex<_Scalar>*) fftw_malloc(sizeof (std::complex<_Scalar>) * nRows * nCols);
+                std::complex<_Scalar>* out = (std::complex<_Scalar>*) fftw_malloc(sizeof (std::complex<_Scalar>) * nRows * nCols);
+
+                if (nRows == 1 || nCols == 1) {
+                    plan = planDft1d(nRows * nCols, in, out, sign, flags);
+                } else {
+                    plan = planDft2d(nCols, nRows, in, out, sign, flags);
+                }
+
+                fftw_free(in);
+                fftw_free(out);
+            }
+        }
+    }
+
+    template<typename _Scalar>
+    void BasicFourierTransform<_Scalar>::resizeBatch(int nRows, int nCols, int batchSize, int sign) {
+        if (batchSize <= 0) {
+            throw Exception("Can't resize a FourierTransform with a batch size<=0");
+        } else if (batchSize == 1) {
+            resize(nRows, nCols, sign);
+        } else if (nRows <= 0 || nCols <= 0) {
+            throw Exception("Can't resize a FourierTransform with rows<=0 or cols<=0");
+        } else if (nRows != this->nRows || nCols != this->nCols || sign != this->sign || real || batchSize != this->batchSize) {
+            if (plan != NULL) {
+                destroyPlan(plan);
             }
 
+            this->nRows = nRows;
+            this->nCols = nCols;
+            this->sign = sign;
+            this->real = false;
+            this->batchSize = batchSize;
+
+            importEnvironmentWisdom();
+            planWithNThreads<_Scalar>(nThreads);
+            // Without buffering, the executions of the plans allocate nothing 
+            // (but for the sizes with large prime factors)
+            unsigned flags = plannerFlags | FFTW_NO_BUFFERING;
+
+            // The arrays are contiguous in the column major storage, each one is transposed for FFTW like a single 2-D transform
+            std::complex<_Scalar>* in = (std::complex<_Scalar>*) fftw_malloc(sizeof (std::complex<_Scalar>) * nRows * nCols * batchSize);
+            std::complex<_Scalar>* out = (std::complex<_Scalar>*) fftw_malloc(sizeof (std::complex<_Scalar>) * nRows * nCols * batchSize);
+            plan = planManyDft2d(nCols, nRows, batchSize, in, out, sign, flags);
             fftw_free(in);
             fftw_free(out);
+
+            if (plannerFlags != FFTW_ESTIMATE) {
+                exportEnvironmentWisdom();
+            }
         }
     }
 
-    void FourierTransform::compute(const Eigen::ArrayXXcd& in, Eigen::ArrayXXcd& out) {
+    template<typename _Scalar>
+    void BasicFourierTransform<_Scalar>::replan() {
+        int nRows = this->nRows;
+        this->nRows = 0;
+        if (batchSize > 1) {
+            resizeBatch(nRows, nCols, batchSize, sign);
+        } else {
+            resize(nRows, nCols, sign, real);
+        }
+    }
+
+    template<typename _Scalar>
+    void BasicFourierTransform<_Scalar>::setPlannerFlags(unsigned plannerFlags) {
+        if (plannerFlags != this->plannerFlags) {
+            this->plannerFlags = plannerFlags;
+            if (plan != NULL) {
+                replan();
+            }
+        }
+    }
+
+    template<typename _Scalar>
+    void BasicFourierTransform<_Scalar>::setNumberOfThreads(int nThreads) {
+        if (nThreads < 1) {
+            throw Exception("The number of threads of a FourierTransform must be positive.");
+        } else if (nThreads != this->nThreads) {
+            this->nThreads = nThreads;
+            if (plan != NULL) {
+                replan();
+            }
+        }
+    }
+
+    template<typename _Scalar>
+    void BasicFourierTransform<_Scalar>::compute(const ComplexArray& in, ComplexArray& out) {
         resize(in.rows(), in.cols(), sign);
         out.resize(nRows, nCols);
-        fftw_execute_dft(plan, (fftw_complex*) in.data(), (fftw_complex*) out.data());
+        executeDft(plan, in.data(), out.data());
     }
 
-    void FourierTransform::compute(const Eigen::ArrayXcd& in, Eigen::ArrayXcd& out) {
+    template<typename _Scalar>
+    void BasicFourierTransform<_Scalar>::compute(const ComplexVector& in, ComplexVector& out) {
         resize(in.rows(), in.cols(), sign);
         out.resize(nRows, nCols);
-        fftw_execute_dft(plan, (fftw_complex*) in.data(), (fftw_complex*) out.data());
+        executeDft(plan, in.data(), out.data());
     }
-    
-    void FourierTransform::setSign(int sign) {
-        resize(nRows, nCols, sign);
+
+    template<typename _Scalar>
+    void BasicFourierTransform<_Scalar>::compute(const RealArray& in, ComplexArray& out) {
+        resize(in.rows(), in.cols(), FFTW_FORWARD, true);
+        out.resize(nRows / 2 + 1, nCols);
+        executeDftR2c(plan, in.data(), out.data());
+    }
+
+    template<typename _Scalar>
+    void BasicFourierTransform<_Scalar>::compute(const ComplexArray& in, RealArray& out) {
+        if (!real || sign != FFTW_BACKWARD || in.rows() != nRows / 2 + 1 || in.cols() != nCols) {
+            throw Exception("The complex-to-real FourierTransform must be resized with the size of the real output array");
+        }
+        out.resize(nRows, nCols);
+        buffer = in;
+        executeDftC2r(plan, buffer.data(), out.data());
+    }
+
+    template<typename _Scalar>
+    void BasicFourierTransform<_Scalar>::computeBatch(const ComplexArray& in, ComplexArray& out, int batchSize) {
+        if (batchSize <= 0 || in.cols() % batchSize != 0) {
+            throw Exception("The number of columns of a batch must be a multiple of the batch size");
+        }
+        resizeBatch(in.rows(), in.cols() / batchSize, batchSize, sign);
+        out.resize(in.rows(), in.cols());
+        executeDft(plan, in.data(), out.data());
     }
 
+    template<typename _Scalar>
+    void BasicFourierTransform<_Scalar>::setSign(int sign) {
+        if (batchSize > 1) {
+            resizeBatch(nRows, nCols, batchSize, sign);
+        } else {
+            resize(nRows, nCols, sign, real);
+        }
+    }
+
+    template class BasicFourierTransform<double>;
+#ifdef USE_FLOAT
+    template class BasicFourierTransform<float>;
+#endif
+
 #else
 
 #include "ooura/fft2d/fftsg.cpp"
 #include "ooura/fft2d/fftsg2d.cpp"
 
-    FourierTransform::FourierTransform(int sign) {
-        data = NULL;
-        workArea = NULL;
-        bitReversal = NULL;
-        cosSinTable = NULL;
-        nRows = 0;
-        nCols = 0;
-        this -> sign = sign;
+    // Ooura's implementation does not need any plan: no wisdom and no planner
+
+    template<>
+    bool BasicFourierTransform<double>::importWisdom(const std::string&) {
+        return false;
     }
 
-    FourierTransform::FourierTransform(int rows, int cols, int sign) : FourierTransform() {
-        resize(rows, cols, sign);
+    template<>
+    bool BasicFourierTransform<double>::exportWisdom(const std::string&) {
+        return false;
     }
 
-    FourierTransform::FourierTransform(Eigen::ArrayXXcd& array, int sign) : FourierTransform() {
-        resize(array.rows(), array.cols(), sign);
+    template<>
+    void BasicFourierTransform<double>::setPlannerFlags(unsigned plannerFlags) {
+        this->plannerFlags = plannerFlags;
     }
 
-    FourierTransform::FourierTransform(Eigen::ArrayXcd& array, int sign) : FourierTransform() {
-        resize(array.rows(), array.cols(), sign);
+    // Passes of the 2-D transform split between the threads
+    static const int STOP_PASS = 0;
+    static const int COLUMNS_PASS = 1;
+    static const int ROWS_PASS = 2;
+
+    template<>
+    void BasicFourierTransform<double>::stopWorkers() {
+        if (workers.empty()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(workersMutex);
+            pass = STOP_PASS;
+            passCount++;
+        }
+        passStarted.notify_all();
+        for (int i = 0; i < (int) workers.size(); i++) {
+            workers[i].join();
+        }
+        workers.clear();
     }
 
-    FourierTransform::~FourierTransform() {
-        if (workArea != NULL) {
+    template<>
+    void BasicFourierTransform<double>::setNumberOfThreads(int nThreads) {
+        if (nThreads < 1) {
+            throw Exception("The number of threads of a FourierTransform must be positive.");
+        }
+        if (nThreads != this->nThreads) {
+            stopWorkers();
+        }
+        this->nThreads = nThreads;
+    }
+
+    // Length of the power of two transforms computing a 1-D transform: the 
+    // length itself or, with Bluestein's algorithm, the length of the circular 
+    // convolution with the chirp
+    static int convolutionLength(int length) {
+        if ((length & (length - 1)) == 0) {
+            return length;
+        }
+        int m = 1;
+        while (m < 2 * length - 1) {
+            m <<= 1;
+        }
+        return m;
+    }
+
+    // Ooura's implementation is only available in double precision
+
+    template<>
+    BasicFourierTransform<double>::~BasicFourierTransform() {
+        stopWorkers();
+        if (data != NULL) {
             free(data);
             free(workArea);
             free(bitReversal);
@@ -112,13 +503,146 @@ namespace vernier {
         }
     }
 
-    void FourierTransform::resize(int nRows, int nCols, int sign) {
+    template<>
+    void BasicFourierTransform<double>::prepareChirp(int length, std::vector<double>& chirp, std::vector<double>& kernel) {
+        int m = convolutionLength(length);
+        if (m == length) {
+            chirp.clear();
+            kernel.clear();
+            return;
+        }
+        chirp.resize(2 * length);
+        std::complex<double>* w = reinterpret_cast<std::complex<double>*> (chirp.data());
+        for (int k = 0; k < length; k++) {
+            // k^2 is reduced modulo 2*length to keep the accuracy of the phase for large k
+            w[k] = std::polar(1.0, sign * PI * (double) (((long long) k * k) % (2 * length)) / length);
+        }
+
+        // The normalization of the backward transform of the convolution is included in the kernel
+        kernel.assign(2 * m, 0.0);
+        std::complex<double>* b = reinterpret_cast<std::complex<double>*> (kernel.data());
+        b[0] = std::conj(w[0]) / (double) m;
+        for (int k = 1; k < length; k++) {
+            b[k] = std::conj(w[k]) / (double) m;
+            b[m - k] = b[k];
+        }
+        cdft(2 * m, FFTW_FORWARD, kernel.data(), bitReversal, cosSinTable);
+    }
+
+    template<>
+    void BasicFourierTransform<double>::transformLine(double* line, int length, const std::vector<double>& chirp, const std::vector<double>& kernel, std::vector<double>& convolution) {
+        if (kernel.empty()) {
+            cdft(2 * length, sign, line, bitReversal, cosSinTable);
+            return;
+        }
+
+        // Bluestein's algorithm: X(k) = w(k) sum x(j) w(j) conj(w(k-j)) with w(k) = exp(sign i pi k^2 / n)
+        int m = kernel.size() / 2;
+        convolution.assign(2 * m, 0.0);
+        std::complex<double>* x = reinterpret_cast<std::complex<double>*> (line);
+        std::complex<double>* c = reinterpret_cast<std::complex<double>*> (convolution.data());
+        const std::complex<double>* w = reinterpret_cast<const std::complex<double>*> (chirp.data());
+        const std::complex<double>* b = reinterpret_cast<const std::complex<double>*> (kernel.data());
+        for (int k = 0; k < length; k++) {
+            c[k] = x[k] * w[k];
+        }
+        cdft(2 * m, FFTW_FORWARD, convolution.data(), bitReversal, cosSinTable);
+        for (int k = 0; k < m; k++) {
+            c[k] *= b[k];
+        }
+        cdft(2 * m, FFTW_BACKWARD, convolution.data(), bitReversal, cosSinTable);
+        for (int k = 0; k < length; k++) {
+            x[k] = c[k] * w[k];
+        }
+    }
+
+    // 1-D transforms along the columns [colBegin, colEnd[ of the column major complex array
+    template<>
+    void BasicFourierTransform<double>::transformColumns(int colBegin, int colEnd, int thread) {
+        for (int col = colBegin; col < colEnd; col++) {
+            transformLine(data[col], nRows, rowsChirp, rowsKernel, convolutionBuffers[thread]);
+        }
+    }
+
+    // 1-D transforms along the rows [rowBegin, rowEnd[ of the column major complex array
+    template<>
+    void BasicFourierTransform<double>::transformRows(int rowBegin, int rowEnd, int thread) {
+        std::vector<double>& line = lineBuffers[thread];
+        std::vector<double>& convolution = convolutionBuffers[thread];
+        line.resize(2 * nCols);
+        for (int row = rowBegin; row < rowEnd; row++) {
+            for (int col = 0; col < nCols; col++) {
+                line[2 * col] = data[col][2 * row];
+                line[2 * col + 1] = data[col][2 * row + 1];
+            }
+            transformLine(line.data(), nCols, colsChirp, colsKernel, convolution);
+            for (int col = 0; col < nCols; col++) {
+                data[col][2 * row] = line[2 * col];
+                data[col][2 * row + 1] = line[2 * col + 1];
+            }
+        }
+    }
+
+    template<>
+    void BasicFourierTransform<double>::transformPart(int pass, int thread) {
+        if (pass == COLUMNS_PASS) {
+            transformColumns(nCols * thread / nThreads, nCols * (thread + 1) / nThreads, thread);
+        } else {
+            transformRows(nRows * thread / nThreads, nRows * (thread + 1) / nThreads, thread);
+        }
+    }
+
+    template<>
+    void BasicFourierTransform<double>::runWorker(int thread, int lastPass) {
+        while (true) {
+            int pass;
+            {
+                std::unique_lock<std::mutex> lock(workersMutex);
+                passStarted.wait(lock, [&] {
+                    return passCount != lastPass;
+                });
+                lastPass = passCount;
+                pass = this->pass;
+            }
+            if (pass == STOP_PASS) {
+                return;
+            }
+            transformPart(pass, thread);
+            std::lock_guard<std::mutex> lock(workersMutex);
+            if (--runningWorkers == 0) {
+                passFinished.notify_one();
+            }
+        }
+    }
+
+    template<>
+    void BasicFourierTransform<double>::runPass(int pass) {
+        if ((int) workers.size() != nThreads - 1) {
+            stopWorkers();
+            for (int i = 1; i < nThreads; i++) {
+                workers.push_back(std::thread(&BasicFourierTransform<double>::runWorker, this, i, passCount));
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(workersMutex);
+            this->pass = pass;
+            runningWorkers = workers.size();
+            passCount++;
+        }
+        passStarted.notify_all();
+        transformPart(pass, 0);
+        std::unique_lock<std::mutex> lock(workersMutex);
+        passFinished.wait(lock, [&] {
+            return runningWorkers == 0;
+        });
+    }
+
+    template<>
+    void BasicFourierTransform<double>::resize(int nRows, int nCols, int sign, bool real) {
         if (nRows <= 0 || nCols <= 0) {
             throw Exception("Can't resize a FourierTransform with rows<=0 or cols<=0");
-        } else if (((nRows & (nRows - 1)) != 0) || ((nCols & (nCols - 1)) != 0)) {
-            throw Exception("The dimensions of a FourierTransform must be a power of two");
         } else if (nRows != this->nRows || nCols != this->nCols || sign != this->sign) {
-            if (workArea != NULL) {
+            if (data != NULL) {
                 free(data);
                 free(workArea);
                 free(bitReversal);
@@ -130,34 +654,168 @@ namespace vernier {
             this->sign = sign;
 
             data = (double**) malloc(sizeof (double*) * nCols);
-            workArea = NULL;
-            int n = 2 + (int) sqrt(std::max(nRows, nCols));
-            bitReversal = (int*) malloc(sizeof (int) * n);
-            n = std::max(nRows, nCols) / 2;
-            cosSinTable = (double*) malloc(sizeof (double) * n);
+            // Largest work area of cdft2d (which would otherwise allocate it at each call)
+            workArea = (double*) malloc(sizeof (double) * 8 * nCols);
+            // Ooura's tables are shared by all the transforms up to the largest one
+            int n = std::max(convolutionLength(nRows), convolutionLength(nCols));
+            bitReversal = (int*) malloc(sizeof (int) * (2 + (int) sqrt(n)));
+            cosSinTable = (double*) malloc(sizeof (double) * std::max(1, n / 2));
             bitReversal[0] = 0;
+            prepareChirp(nRows, rowsChirp, rowsKernel);
+            prepareChirp(nCols, colsChirp, colsKernel);
+        }
+        // Ooura's tables do not depend on the real mode, the full complex transform is always computed
+        this->real = real;
+        this->batchSize = 1;
+    }
+
+    template<>
+    void BasicFourierTransform<double>::resizeBatch(int nRows, int nCols, int batchSize, int sign) {
+        if (batchSize <= 0) {
+            throw Exception("Can't resize a FourierTransform with a batch size<=0");
+        }
+        // The same tables are used for all the arrays of the batch
+        resize(nRows, nCols, sign);
+        this->batchSize = batchSize;
+    }
+
+    template<>
+    BasicFourierTransform<double>::BasicFourierTransform(int sign) {
+        data = NULL;
+        workArea = NULL;
+        bitReversal = NULL;
+        cosSinTable = NULL;
+        nRows = 0;
+        nCols = 0;
+        this -> sign = sign;
+        real = false;
+        plannerFlags = getDefaultPlannerFlags();
+        nThreads = 1;
+        batchSize = 1;
+        pass = STOP_PASS;
+        passCount = 0;
+        runningWorkers = 0;
+    }
+
+    template<>
+    BasicFourierTransform<double>::BasicFourierTransform(int rows, int cols, int sign) : BasicFourierTransform() {
+        resize(rows, cols, sign);
+    }
+
+    template<>
+    BasicFourierTransform<double>::BasicFourierTransform(ComplexArray& array, int sign) : BasicFourierTransform() {
+        resize(array.rows(), array.cols(), sign);
+    }
+
+    template<>
+    BasicFourierTransform<double>::BasicFourierTransform(ComplexVector& array, int sign) : BasicFourierTransform() {
+        resize(array.rows(), array.cols(), sign);
+    }
+
+    template<>
+    void BasicFourierTransform<double>::transform(ComplexArray& array, int firstCol) {
+        // Eigen is column major but Ooura's fft is row major
+        for (int j = 0; j < nCols; j++) {
+            data[j] = (double*) (&array(0, firstCol + j));
+        }
+        if (nThreads == 1 && rowsKernel.empty() && colsKernel.empty()) {
+            cdft2d(nCols, 2 * nRows, sign, data, workArea, bitReversal, cosSinTable);
+            return;
+        }
+
+        // Same passes as cdft2d, the tables are prepared first then only read by the threads
+        int n = 2 * std::max(convolutionLength(nRows), convolutionLength(nCols));
+        if (n > (bitReversal[0] << 2)) {
+            makewt(n >> 2, bitReversal, cosSinTable);
+        }
+        if ((int) convolutionBuffers.size() < nThreads) {
+            lineBuffers.resize(nThreads);
+            convolutionBuffers.resize(nThreads);
+        }
+        if (nThreads == 1) {
+            transformColumns(0, nCols, 0);
+            if (nCols > 1) {
+                transformRows(0, nRows, 0);
+            }
+            return;
+        }
+        runPass(COLUMNS_PASS);
+        if (nCols > 1) {
+            runPass(ROWS_PASS);
         }
     }
 
-    void FourierTransform::compute(Eigen::ArrayXXcd& in, Eigen::ArrayXXcd& out) {
+    template<>
+    void BasicFourierTransform<double>::compute(const ComplexArray& in, ComplexArray& out) {
         resize(in.rows(), in.cols(), sign);
         out = in;
-        // Eigen is column major but Ooura's fft is row major
-        for (int j = 0; j < out.cols(); j++) {
-            data[j] = (double*) (&out(0, j));
+        transform(out);
+    }
+
+    template<>
+    void BasicFourierTransform<double>::compute(const ComplexVector& in, ComplexVector& out) {
+        resize(in.rows(), 1, sign);
+        out = in;
+        if (convolutionBuffers.empty()) {
+            lineBuffers.resize(1);
+            convolutionBuffers.resize(1);
         }
-        cdft2d(nCols, 2 * nRows, sign, data, workArea, bitReversal, cosSinTable);
-        out = out.conjugate();
+        transformLine((double*) out.data(), nRows, rowsChirp, rowsKernel, convolutionBuffers[0]);
+    }
+
+    template<>
+    void BasicFourierTransform<double>::compute(const RealArray& in, ComplexArray& out) {
+        resize(in.rows(), in.cols(), FFTW_FORWARD, true);
+        buffer.resize(nRows, nCols);
+        buffer.real() = in;
+        buffer.imag().setZero();
+        transform(buffer);
+        out = buffer.topRows(nRows / 2 + 1);
     }
 
-    void FourierTransform::compute(Eigen::ArrayXcd& in, Eigen::ArrayXcd& out) {
-        throw Exception("Computing of 1D FFT not yet supported by FourierTransform::compute without FFTW");
+    template<>
+    void BasicFourierTransform<double>::compute(const ComplexArray& in, RealArray& out) {
+        if (!real || sign != FFTW_BACKWARD || in.rows() != nRows / 2 + 1 || in.cols() != nCols) {
+            throw Exception("The complex-to-real FourierTransform must be resized with the size of the real output array");
+        }
+        // The full spectrum is rebuilt from the Hermitian symmetry
+        buffer.resize(nRows, nCols);
+        for (int col = 0; col < nCols; col++) {
+            int mirrorCol = (nCols - col) % nCols;
+            for (int row = 0; row < nRows; row++) {
+                if (row < in.rows()) {
+                    buffer(row, col) = in(row, col);
+                } else {
+                    buffer(row, col) = std::conj(in(nRows - row, mirrorCol));
+                }
+            }
+        }
+        transform(buffer);
+        out = buffer.real();
     }
     
-    void FourierTransform::setSign(int sign) {
-        resize(nRows, nCols, sign);
+    template<>
+    void BasicFourierTransform<double>::computeBatch(const ComplexArray& in, ComplexArray& out, int batchSize) {
+        if (batchSize <= 0 || in.cols() % batchSize != 0) {
+            throw Exception("The number of columns of a batch must be a multiple of the batch size");
+        }
+        resizeBatch(in.rows(), in.cols() / batchSize, batchSize, sign);
+        out = in;
+        for (int i = 0; i < batchSize; i++) {
+            transform(out, i * nCols);
+        }
+    }
+
+    template<>
+    void BasicFourierTransform<double>::setSign(int sign) {
+        if (batchSize > 1) {
+            resizeBatch(nRows, nCols, batchSize, sign);
+        } else {
+            resize(nRows, nCols, sign, real);
+        }
     }
 
+    template class BasicFourierTransform<double>;
 
 #endif
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -5,6 +5,7 @@
  */
 
 #include "GaussianFilter.hpp"
+#include "Spectrum.hpp"
 
 namespace vernier {
 
@@ -19,7 +20,9 @@ namespace vernier {
     void GaussianFilter::resize(int nRows, int nCols) {
         if (nRows <= 0 || nCols <= 0) {
             throw Exception("Can't resize a HyperGaussianFilter with rows<=0 or cols<=0");
-        } else if (nRows != kernel.rows() || nCols != kernel.cols()) {
+        } else {
+            // the kernel is always recomputed since sigma may have changed 
+            // without changing the kernel size (no reallocation in this case)
             kernel.resize(nRows, nCols);
             int kernelCenterRow = nRows / 2;
             int kernelCenterCol = nCols / 2;
@@ -46,7 +49,8 @@ namespace vernier {
         }
     }
 
-    void GaussianFilter::applyTo(Eigen::ArrayXXcd& inputArray, int centerRow, int centerCol) {
+    template<typename _Scalar>
+    void GaussianFilter::applyTo(Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& inputArray, int centerRow, int centerCol) {
         int kernelCenterRow = kernel.rows() / 2;
         int kernelCenterCol = kernel.cols() / 2;
         for (int col = 0; col < inputArray.cols(); col++) {
@@ -55,7 +59,7 @@ namespace vernier {
                 for (int row = 0; row < inputArray.rows(); row++) {
                     int kernelRow = row - (centerRow - kernelCenterRow);
                     if (kernelRow >= 0 && kernelRow < kernel.rows()) {
-                        inputArray(row, col) *= kernel(kernelRow, kernelCol);
+                        inputArray(row, col) *= (_Scalar) kernel(kernelRow, kernelCol);
                     } else {
                         inputArray(row, col) = 0.0;
                     }
@@ -68,6 +72,87 @@ namespace vernier {
         }
     }
 
+    template<typename _Scalar>
+    void GaussianFilter::applyTo(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& spectrum, Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& outputArray, int centerRow, int centerCol) {
+        int rowOffset = centerRow - kernel.rows() / 2;
+        int colOffset = centerCol - kernel.cols() / 2;
+        int rowMin = std::max(0, rowOffset);
+        int rowMax = std::min((int) spectrum.rows(), rowOffset + (int) kernel.rows());
+        int colMin = std::max(0, colOffset);
+        int colMax = std::min((int) spectrum.cols(), colOffset + (int) kernel.cols());
+        outputArray.setZero();
+        for (int col = colMin; col < colMax; col++) {
+            for (int row = rowMin; row < rowMax; row++) {
+                outputArray(row, col) = (_Scalar) kernel(row - rowOffset, col - colOffset) * spectrum(row, col);
+            }
+        }
+    }
+
+    template<typename _Scalar>
+    void GaussianFilter::applyTo(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSpectrum, int nRows, Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& outputArray, int centerRow, int centerCol) {
+        int rowOffset = centerRow - kernel.rows() / 2;
+        int colOffset = centerCol - kernel.cols() / 2;
+        int rowMin = std::max(0, rowOffset);
+        int rowMax = std::min(nRows, rowOffset + (int) kernel.rows());
+        int colMin = std::max(0, colOffset);
+        int colMax = std::min((int) outputArray.cols(), colOffset + (int) kernel.cols());
+        outputArray.setZero();
+        for (int col = colMin; col < colMax; col++) {
+            for (int row = rowMin; row < rowMax; row++) {
+                outputArray(row, col) = (_Scalar) kernel(row - rowOffset, col - colOffset) * Spectrum::hermitianValue(halfSpectrum, nRows, row, col);
+            }
+        }
+    }
+
+    template<typename _Scalar>
+    void GaussianFilter::applyToWindow(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& spectrum, Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& window, int centerRow, int centerCol) {
+        int nRows = spectrum.rows();
+        int nCols = spectrum.cols();
+        int rowOffset = centerRow - kernel.rows() / 2;
+        int colOffset = centerCol - kernel.cols() / 2;
+        int windowRowOffset = centerRow - window.rows() / 2;
+        int windowColOffset = centerCol - window.cols() / 2;
+        int rowMin = std::max(std::max(0, rowOffset), windowRowOffset);
+        int rowMax = std::min(std::min(nRows, rowOffset + (int) kernel.rows()), windowRowOffset + (int) window.rows());
+        int colMin = std::max(std::max(0, colOffset), windowColOffset);
+        int colMax = std::min(std::min(nCols, colOffset + (int) kernel.cols()), windowColOffset + (int) window.cols());
+        window.setZero();
+        for (int col = colMin; col < colMax; col++) {
+            for (int row = rowMin; row < rowMax; row++) {
+                window(row - windowRowOffset, col - windowColOffset) = (_Scalar) kernel(row - rowOffset, col - colOffset) * spectrum(row, col);
+            }
+        }
+    }
+
+    template<typename _Scalar>
+    void GaussianFilter::applyToWindow(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSpectrum, int nRows, Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& window, int centerRow, int centerCol) {
+        int rowOffset = centerRow - kernel.rows() / 2;
+        int colOffset = centerCol - kernel.cols() / 2;
+        int windowRowOffset = centerRow - window.rows() / 2;
+        int windowColOffset = centerCol - window.cols() / 2;
+        int rowMin = std::max(std::max(0, rowOffset), windowRowOffset);
+        int rowMax = std::min(std::min(nRows, rowOffset + (int) kernel.rows()), windowRowOffset + (int) window.rows());
+        int colMin = std::max(std::max(0, colOffset), windowColOffset);
+        int colMax = std::min(std::min((int) halfSpectrum.cols(), colOffset + (int) kernel.cols()), windowColOffset + (int) window.cols());
+        window.setZero();
+        for (int col = colMin; col < colMax; col++) {
+            for (int row = rowMin; row < rowMax; row++) {
+                window(row - windowRowOffset, col - windowColOffset) = (_Scalar) kernel(row - rowOffset, col - colOffset) * Spectrum::hermitianValue(halfSpectrum, nRows, row, col);
+            }
+        }
+    }
+
+    template void GaussianFilter::applyTo(Eigen::ArrayXXcd&, int, int);
+    template void GaussianFilter::applyTo(Eigen::ArrayXXcf&, int, int);
+    template void GaussianFilter::applyTo(const Eigen::ArrayXXcd&, Eigen::ArrayXXcd&, int, int);
+    template void GaussianFilter::applyTo(const Eigen::ArrayXXcf&, Eigen::ArrayXXcf&, int, int);
+    template void GaussianFilter::applyTo(const Eigen::ArrayXXcd&, int, Eigen::ArrayXXcd&, int, int);
+    template void GaussianFilter::applyTo(const Eigen::ArrayXXcf&, int, Eigen::ArrayXXcf&, int, int);
+    template void GaussianFilter::applyToWindow(const Eigen::ArrayXXcd&, Eigen::ArrayXXcd&, int, int);
+    template void GaussianFilter::applyToWindow(const Eigen::ArrayXXcf&, Eigen::ArrayXXcf&, int, int);
+    template void GaussianFilter::applyToWindow(const Eigen::ArrayXXcd&, int, Eigen::ArrayXXcd&, int, int);
+    template void GaussianFilter::applyToWindow(const Eigen::ArrayXXcf&, int, Eigen::ArrayXXcf&, int, int);
+
     void gaussianFilter(Eigen::ArrayXXcd& array, double centerRow, double centerCol, double sigma) {
         double sigma2 = 2 * sigma * sigma;
         for (int col = 0; col < array.cols(); col++) {
@@ -80,4 +165,4 @@ namespace vernier {
             }
         }
     }
-}
\ No newline at end of file
+}
\ No newline at end of file
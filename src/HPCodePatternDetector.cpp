@@ -53,6 +53,7 @@ namespace vernier {
 
         detector.compute(image);
 
+        snapshots.resize(detector.codes.size());
         for (int i = 0; i < detector.codes.size(); i++) {
 
             QRCode code = detector.codes[i];
@@ -64,33 +65,41 @@ namespace vernier {
                 throw Exception("The HPCode is too tiny for pose estimation: increase the picture quality size.");
             }
 
+            takeSnapshot((int) code.center.x, (int) code.center.y, image);
+            snapshots[i] = snapshot;
+        }
+        patternPhase.computeBatch(snapshots);
+
+        for (int i = 0; i < (int) detector.codes.size(); i++) {
+
+            QRCode code = detector.codes[i];
             int centerX = (int) code.center.x;
             int centerY = (int) code.center.y;
-            takeSnapshot(centerX, centerY, image);
-            patternPhase.compute(snapshot);
+            PhasePlane plane1 = patternPhase.getBatchPlane1(i);
+            PhasePlane plane2 = patternPhase.getBatchPlane2(i);
 
             double alpha;
             double dx, dy;
-            double diffAngle = angleInPiPi(patternPhase.getPlane1().getAngle() - code.getAngle());
+            double diffAngle = angleInPiPi(plane1.getAngle() - code.getAngle());
             if (diffAngle >= -PI / 4 && diffAngle <= PI / 4) {
-                alpha = patternPhase.getPlane1().getAngle();
-                dx = -patternPhase.getPlane1().getPosition(physicalPeriod, 0.0, 0.0);
-                dy = -patternPhase.getPlane2().getPosition(physicalPeriod, 0.0, 0.0);
+                alpha = plane1.getAngle();
+                dx = -plane1.getPosition(physicalPeriod, 0.0, 0.0);
+                dy = -plane2.getPosition(physicalPeriod, 0.0, 0.0);
             } else if (diffAngle >= 3 * PI / 4 || diffAngle <= -3 * PI / 4) {
-                alpha = patternPhase.getPlane1().getAngle() + PI;
-                dx = +patternPhase.getPlane1().getPosition(physicalPeriod, 0.0, 0.0);
-                dy = +patternPhase.getPlane2().getPosition(physicalPeriod, 0.0, 0.0);
+                alpha = plane1.getAngle() + PI;
+                dx = +plane1.getPosition(physicalPeriod, 0.0, 0.0);
+                dy = +plane2.getPosition(physicalPeriod, 0.0, 0.0);
             } else if (diffAngle >= PI / 4 && diffAngle <= 3 * PI / 4) {
-                alpha = patternPhase.getPlane1().getAngle() - PI / 2;
-                dx = patternPhase.getPlane2().getPosition(physicalPeriod, 0.0, 0.0);
-                dy = -patternPhase.getPlane1().getPosition(physicalPeriod, 0.0, 0.0);
+                alpha = plane1.getAngle() - PI / 2;
+                dx = plane2.getPosition(physicalPeriod, 0.0, 0.0);
+                dy = -plane1.getPosition(physicalPeriod, 0.0, 0.0);
             } else {
-                alpha = patternPhase.getPlane1().getAngle() + PI / 2;
-                dx = -patternPhase.getPlane2().getPosition(physicalPeriod, 0.0, 0.0);
-                dy = patternPhase.getPlane1().getPosition(physicalPeriod, 0.0, 0.0);
+                alpha = plane1.getAngle() + PI / 2;
+                dx = -plane2.getPosition(physicalPeriod, 0.0, 0.0);
+                dy = plane1.getPosition(physicalPeriod, 0.0, 0.0);
             }
 
-            double pixelSize = physicalPeriod / patternPhase.getPixelPeriod();
+            double pixelSize = physicalPeriod / plane1.getPixelicPeriod();
             double xImg = (centerX - image.cols / 2);
             double yImg = (centerY - image.rows / 2);
             double x = pixelSize * (xImg * cos(alpha) - yImg * sin(-alpha)) + dx;
@@ -99,7 +108,7 @@ namespace vernier {
             Pose pose = Pose(x, y, alpha, pixelSize);
 
             if ((numberHalfPeriods - 1) % 4 == 0) {
-                unsigned long number = readNumber(code, image, patternPhase.getPixelPeriod() / 2.0);
+                unsigned long number = readNumber(code, image, plane1.getPixelicPeriod() / 2.0);
 
                 codes.insert(std::make_pair(number, pose));
             } else {
@@ -126,9 +126,6 @@ namespace vernier {
 
         // sequence 1
 
-        //Pour contraste:
-        Eigen::VectorXd contrastVec1;
-        
         for (int index1 = startIndex1; index1 < stopIndex1; index1++) {
             if (index1 % 3 != coding1 % 3) {
                 sequence1(index1) = 0;
@@ -160,10 +157,6 @@ namespace vernier {
                 codeIntensity1(index1, 1) = meanBackRefDots1(index1);
                 codeIntensity1(index1, 2) = meanWhiteRefDots1(index1);
 
-                contrastVec1.conservativeResize(contrastVec1.rows() + 1, contrastVec1.cols());
-
-                contrastVec1(contrastVec1.rows() - 1) = (codeIntensity1(index1, 2) - codeIntensity1(index1, 1));
-
                 //std::cout << (codeIntensity1(index1, 2) - codeIntensity1(index1, 1)) / 256.0 << std::endl;
 
                 if (abs(meanCodingDots1(index1) - meanBackRefDots1(index1)) < abs(meanWhiteRefDots1(index1) - meanCodingDots1(index1))) {
@@ -177,9 +170,6 @@ namespace vernier {
 
         // sequence 2
 
-        //Pour contraste:
-        Eigen::VectorXd contrastVec2;
-
         for (int index2 = startIndex2; index2 < stopIndex2; index2++) {
             if (index2 % 3 != coding2 % 3) {
                 sequence2(index2) = 0;
@@ -211,9 +201,6 @@ namespace vernier {
                 codeIntensity2(index2, 1) = meanBackRefDots2(index2);
                 codeIntensity2(index2, 2) = meanWhiteRefDots2(index2);
 
-                contrastVec2.conservativeResize(contrastVec2.rows() + 1, contrastVec2.cols());
-                contrastVec2(contrastVec2.rows() - 1) = (codeIntensity2(index2, 2) - codeIntensity2(index2, 1));
-
                 //std::cout << (codeIntensity2(index2, 2) - codeIntensity2(index2, 1)) / 256.0 << std::endl;
 
                 if (abs(meanCodingDots2(index2) - meanBackRefDots2(index2)) < abs(meanWhiteRefDots2(index2) - meanCodingDots2(index2))) {
@@ -54,16 +54,14 @@ namespace vernier {
     }
 
     void PatternDetector::compute(char* data, int rows, int cols) {
-        Eigen::MatrixXd mPatternMatrix(rows, cols);
-        std::memcpy(mPatternMatrix.data(), data, rows * cols * sizeof (double));
-
-        Eigen::ArrayXXd patternImage = mPatternMatrix.array();
-        computeArray(patternImage);
+        imageArray.resize(rows, cols);
+        std::memcpy(imageArray.data(), data, rows * cols * sizeof (double));
+        computeArray(imageArray);
     }
 
     void PatternDetector::compute(const cv::Mat & image) {
-        Eigen::ArrayXXd array = image2array(image);
-        computeArray(array);
+        image2array(image, imageArray);
+        computeArray(imageArray);
     }
     
     void PatternDetector::computeArray(const Eigen::ArrayXXd & array) {
@@ -11,6 +11,22 @@ namespace vernier {
     PatternPhase::PatternPhase() {
         this->peaksSearchMethod = 0;
         this->pixelPeriod = 0.0;
+        this->minPixelPeriod = 0.0;
+        this->maxPixelPeriod = 0.0;
+        this->realSpectrum = false;
+        this->centeredSpectrum = false;
+        this->nRows = 0;
+        this->nCols = 0;
+        this->maxDecimationFactor = 1;
+        this->decimationFactor = 1;
+        this->tracking = false;
+        this->trackingRadius = 2;
+        this->trackablePlanes = false;
+        this->unwrapping = true;
+        this->fastMode = false;
+        this->pyramidFactor = 1;
+        this->nThreads = 1;
+        this->unwrappedPhasesOutdated = false;
         setSigma(3);
     }
 
@@ -20,85 +36,337 @@ namespace vernier {
 
     void PatternPhase::resize(int nRows, int nCols) {
         if (nRows != this->getNRows() || nCols != this->getNCols()) {
+            this->nRows = nRows;
+            this->nCols = nCols;
             fft.resize(nRows, nCols, FFTW_FORWARD);
+            fftReal.resize(nRows, nCols, FFTW_FORWARD, true);
             ifft.resize(nRows, nCols, FFTW_BACKWARD);
             regressionPlane.resize(nRows, nCols);
+            spatial.resize(nRows, nCols);
             spectrum.resize(nRows, nCols);
             spectrumShifted.resize(nRows, nCols);
             spectrumFiltered1.resize(nRows, nCols);
-            spectrumFiltered1.resize(nRows, nCols);
+            spectrumFiltered2.resize(nRows, nCols);
             phase1.resize(nRows, nCols);
             phase2.resize(nRows, nCols);
-            unwrappedPhase1.resize(nRows, nCols);
-            unwrappedPhase2.resize(nRows, nCols);
-            spectrum.resize(nRows, nCols);
+            trackablePlanes = false;
+            updateAnnulus();
+            updatePyramid();
+        }
+        updateDecimationFactor();
+    }
+
+    void PatternPhase::updateAnnulus() {
+        if (minPixelPeriod > 0.0 && nRows > 0 && nCols > 0) {
+            Spectrum::annulusIndices(nRows, nCols, minPixelPeriod, maxPixelPeriod, annulus);
+        } else {
+            annulus.clear();
+        }
+    }
+
+    void PatternPhase::updatePyramid() {
+        // Even binned sizes for the real-to-complex transform, the last pixels are dropped
+        if (pyramidFactor > 1 && nRows > 0 && nCols > 0) {
+            int binnedRows = 2 * (nRows / (2 * pyramidFactor));
+            int binnedCols = 2 * (nCols / (2 * pyramidFactor));
+            if (binnedRows < 2 || binnedCols < 2) {
+                throw Exception("The pyramid factor of PatternPhase is too large for the image size.");
+            }
+            binnedImage.resize(binnedRows, binnedCols);
+            binnedSpectrum.resize(binnedRows / 2 + 1, binnedCols);
+            fftBinned.resize(binnedRows, binnedCols, FFTW_FORWARD, true);
+        }
+    }
+
+    void PatternPhase::updateDecimationFactor() {
+        // Largest factor keeping the whole filter kernel in the decimated spectrum (with even sizes for Spatial::shift)
+        decimationFactor = 1;
+        int kernelSize = gaussianFilter.getKernelSize();
+        for (int factor = 2; factor <= maxDecimationFactor && nRows / factor >= kernelSize && nCols / factor >= kernelSize; factor++) {
+            if (nRows % (2 * factor) == 0 && nCols % (2 * factor) == 0) {
+                decimationFactor = factor;
+            }
+        }
+        if (decimationFactor > 1) {
+            ifftDecimated.resize(nRows / decimationFactor, nCols / decimationFactor, FFTW_BACKWARD);
         }
     }
 
     void PatternPhase::compute(const Eigen::ArrayXXd& image) {
-        spatial.resize(image.rows(), image.cols());
-        spatial.real() = image;
-        compute(spatial);
+        resize(image.rows(), image.cols());
+        realSpectrum = true;
+
+#ifdef USE_FLOAT
+        this->image = image.cast<Real>();
+        fftReal.compute(this->image, spectrum);
+#else
+        fftReal.compute(image, spectrum);
+#endif
+
+        if (!trackPeaks()) {
+            if (pyramidFactor > 1) {
+                findPyramidPeaks(image);
+            } else {
+                findPeaks();
+            }
+        }
+
+        if (fastMode) {
+            computeFastPlanes(image);
+            return;
+        }
+
+        filterPeaks();
+
+        computePlanes();
     }
 
     void PatternPhase::compute(const cv::Mat& image) {
-        Eigen::ArrayXXd array = image2array(image);
-        compute(array);
+        image2array(image, imageArray);
+        compute(imageArray);
     }
 
     void PatternPhase::compute(const Eigen::ArrayXXcd& patternArray) {
         resize(patternArray.rows(), patternArray.cols());
+        realSpectrum = false;
+        centeredSpectrum = true;
+
+        // The modulated input gives directly the shifted spectrum
+        Spatial::shift(patternArray, spatial);
+        fft.compute(spatial, spectrum);
+
+        if (!trackPeaks()) {
+            if (pyramidFactor > 1) {
+                findPyramidPeaks(patternArray);
+            } else {
+                findPeaks();
+            }
+        }
 
-        fft.compute(patternArray, spectrum);
+        if (fastMode) {
+            computeFastPlanes(patternArray);
+            return;
+        }
 
-        Spectrum::shift(spectrum, spectrumShifted);
-        spectrumFiltered1 = spectrumShifted;
-        spectrumFiltered2 = spectrumShifted;
+        filterPeaks();
+
+        computePlanes();
+    }
 
-        if (pixelPeriod == 0.0) {
-            Spectrum::mainPeakHalfPlane(spectrumShifted, mainPeak1, mainPeak2);
+    void PatternPhase::computeBatch(const std::vector<Eigen::ArrayXXcd>& images) {
+        int batchSize = images.size();
+        batchPlanes1.resize(batchSize);
+        batchPlanes2.resize(batchSize);
+        batchPeaks1.resize(batchSize);
+        batchPeaks2.resize(batchSize);
+        if (batchSize == 0) {
+            return;
+        }
+        resize(images[0].rows(), images[0].cols());
+        realSpectrum = false;
+        centeredSpectrum = true;
+        trackablePlanes = false;
+
+        spatialBatch.resize(nRows, nCols * batchSize);
+        for (int i = 0; i < batchSize; i++) {
+            if (images[i].rows() != nRows || images[i].cols() != nCols) {
+                throw Exception("All the images of a PatternPhase batch must have the same size.");
+            }
+            Eigen::ArrayXXcr::ColsBlockXpr block = spatialBatch.middleCols(i * nCols, nCols);
+            Spatial::shift(images[i], block);
+        }
+        fftBatch.resizeBatch(nRows, nCols, batchSize, FFTW_FORWARD);
+        fftBatch.computeBatch(spatialBatch, spectrumBatch, batchSize);
+
+        if (fastMode) {
+            for (int i = 0; i < batchSize; i++) {
+                spectrum = spectrumBatch.middleCols(i * nCols, nCols);
+                findPeaks();
+                computeFastPlanes(images[i]);
+                batchPeaks1[i] = mainPeak1;
+                batchPeaks2[i] = mainPeak2;
+                batchPlanes1[i] = plane1;
+                batchPlanes2[i] = plane2;
+            }
+            trackablePlanes = false;
+            return;
+        }
+
+        int filteredRows = nRows / decimationFactor;
+        int filteredCols = nCols / decimationFactor;
+        spectrumFilteredBatch.resize(filteredRows, 2 * filteredCols * batchSize);
+        for (int i = 0; i < batchSize; i++) {
+            spectrum = spectrumBatch.middleCols(i * nCols, nCols);
+
+            findPeaks();
+
+            filterPeaks();
+            spectrumFilteredBatch.middleCols(2 * i * filteredCols, filteredCols) = spectrumFiltered1;
+            spectrumFilteredBatch.middleCols((2 * i + 1) * filteredCols, filteredCols) = spectrumFiltered2;
+            batchPeaks1[i] = mainPeak1;
+            batchPeaks2[i] = mainPeak2;
+        }
+        ifftBatch.resizeBatch(filteredRows, filteredCols, 2 * batchSize, FFTW_BACKWARD);
+        ifftBatch.computeBatch(spectrumFilteredBatch, phaseBatch, 2 * batchSize);
+
+        for (int i = 0; i < batchSize; i++) {
+            phase1 = phaseBatch.middleCols(2 * i * filteredCols, filteredCols);
+            phase2 = phaseBatch.middleCols((2 * i + 1) * filteredCols, filteredCols);
+            mainPeak1 = batchPeaks1[i];
+            mainPeak2 = batchPeaks2[i];
+            plane1 = computePlane(phase1, mainPeak1);
+            plane2 = computePlane(phase2, mainPeak2);
+            batchPlanes1[i] = plane1;
+            batchPlanes2[i] = plane2;
+        }
+        this->pixelPeriod = plane1.getPixelicPeriod();
+        unwrappedPhasesOutdated = true;
+    }
+
+    void PatternPhase::findPeaks() {
+        if (minPixelPeriod > 0.0) {
+            if (realSpectrum) {
+                Spectrum::mainPeakAnnulus(spectrum, nRows, annulus, mainPeak1, mainPeak2);
+            } else {
+                Spectrum::mainPeakAnnulus(spectrum, annulus, mainPeak1, mainPeak2);
+            }
+            return;
+        }
+
+        if (pixelPeriod == 0.0 || peaksSearchMethod == 0) {
+            // The half plane search leaves the spectrum untouched
+            if (realSpectrum) {
+                Spectrum::mainPeakHalfPlane(spectrum, nRows, spectrumMagnitude, mainPeak1, mainPeak2);
+            } else {
+                Spectrum::mainPeakHalfPlane(spectrum, spectrumMagnitude, mainPeak1, mainPeak2);
+            }
+            return;
+        }
+
+        // The other searches may modify their input: they are made on a copy 
+        // and the filters are applied on spectrum
+        if (realSpectrum) {
+            Spectrum::shiftHermitian(spectrum, nRows, spectrumShifted);
         } else {
-            switch (peaksSearchMethod) {
-                case 0:
-                    Spectrum::mainPeakHalfPlane(spectrumShifted, mainPeak1, mainPeak2);
-                    break;
-                case 1:
-                    Spectrum::mainPeak4Search(spectrumShifted, mainPeak1, mainPeak2);
-                    break;
-                case 2:
-                    Spectrum::mainPeakPerimeter(spectrumShifted, mainPeak1, mainPeak2);
-                    break;
-                default:
-                    Spectrum::mainPeakCircle(spectrumShifted, mainPeak1, mainPeak2, pixelPeriod);
-                    ;
-                    break;
+            spectrumShifted = spectrum;
+        }
+        switch (peaksSearchMethod) {
+            case 1:
+                Spectrum::mainPeak4Search(spectrumShifted, mainPeak1, mainPeak2);
+                break;
+            case 2:
+                Spectrum::mainPeakPerimeter(spectrumShifted, mainPeak1, mainPeak2);
+                break;
+            default:
+                Spectrum::mainPeakCircle(spectrumShifted, mainPeak1, mainPeak2, pixelPeriod);
+                break;
+        }
+    }
+
+    /** Sums the blocks of factor x factor pixels of the image into binned */
+    template<typename Derived>
+    static void binImage(const Eigen::ArrayBase<Derived>& image, int factor, Eigen::ArrayXXr& binned) {
+        for (int col = 0; col < binned.cols(); col++) {
+            for (int row = 0; row < binned.rows(); row++) {
+                binned(row, col) = (Real) image.block(row * factor, col * factor, factor, factor).sum();
             }
         }
+    }
 
-        // Compute first plane phase from peak 1
-        gaussianFilter.applyTo(spectrumFiltered1, mainPeak1(1), mainPeak1(0));
+    void PatternPhase::findPyramidPeaks(const Eigen::ArrayXXd& image) {
+        binImage(image, pyramidFactor, binnedImage);
+        searchBinnedPeaks();
+    }
 
-        ifft.compute(spectrumFiltered1, phase1);
-        Spatial::shift(phase1);
+    void PatternPhase::findPyramidPeaks(const Eigen::ArrayXXcd& image) {
+        binImage(image.real(), pyramidFactor, binnedImage);
+        searchBinnedPeaks();
+    }
 
-        unwrappedPhase1 = phase1.arg();
+    void PatternPhase::searchBinnedPeaks() {
+        fftBinned.compute(binnedImage, binnedSpectrum);
+        Spectrum::mainPeakHalfPlane(binnedSpectrum, binnedImage.rows(), binnedMagnitude, mainPeak1, mainPeak2);
+
+        // A bin of the binned spectrum is as wide as a bin of the full spectrum 
+        // (up to the dropped pixels): the expected peaks are within one bin
+        int binnedRows = binnedImage.rows();
+        int binnedCols = binnedImage.cols();
+        double rowScale = (double) nRows / (binnedRows * pyramidFactor);
+        double colScale = (double) nCols / (binnedCols * pyramidFactor);
+        mainPeak1 << std::round(nCols / 2 + (mainPeak1.x() - binnedCols / 2) * colScale), std::round(nRows / 2 + (mainPeak1.y() - binnedRows / 2) * rowScale), 0.0;
+        mainPeak2 << std::round(nCols / 2 + (mainPeak2.x() - binnedCols / 2) * colScale), std::round(nRows / 2 + (mainPeak2.y() - binnedRows / 2) * rowScale), 0.0;
+        if (!searchAroundPeaks(2)) {
+            findPeaks();
+        }
+    }
 
-        Spatial::quartersUnwrapPhase(unwrappedPhase1);
+    bool PatternPhase::trackPeaks() {
+        if (!tracking || !trackablePlanes) {
+            return false;
+        }
 
-        plane1 = regressionPlane.compute(unwrappedPhase1);
+        // The frequencies of the previous phase planes give the expected peaks
+        mainPeak1 << std::round(nCols / 2 + plane1.getA() * nCols / (2 * PI)), std::round(nRows / 2 + plane1.getB() * nRows / (2 * PI)), 0.0;
+        mainPeak2 << std::round(nCols / 2 + plane2.getA() * nCols / (2 * PI)), std::round(nRows / 2 + plane2.getB() * nRows / (2 * PI)), 0.0;
+        return searchAroundPeaks(trackingRadius);
+    }
 
-        this->pixelPeriod = plane1.getPixelicPeriod();
+    bool PatternPhase::searchAroundPeaks(int radius) {
+        if (realSpectrum) {
+            Spectrum::trackPeak(spectrum, nRows, mainPeak1, radius);
+            Spectrum::trackPeak(spectrum, nRows, mainPeak2, radius);
+        } else {
+            Spectrum::trackPeak(spectrum, mainPeak1, radius);
+            Spectrum::trackPeak(spectrum, mainPeak2, radius);
+        }
 
-        // Compute second plase from peak 2
-        gaussianFilter.applyTo(spectrumFiltered2, mainPeak2(1), mainPeak2(0));
-        ifft.compute(spectrumFiltered2, phase2);
-        Spatial::shift(phase2);
+        // Same order as the global search
+        if (mainPeak1.x() < mainPeak2.x()) {
+            std::swap(mainPeak1, mainPeak2);
+        }
+        return peaksFound();
+    }
+
+    void PatternPhase::filterPeaks() {
+        // The filtered spectra are written directly in the inputs of the inverse transforms
+        if (decimationFactor > 1) {
+            spectrumFiltered1.resize(nRows / decimationFactor, nCols / decimationFactor);
+            spectrumFiltered2.resize(nRows / decimationFactor, nCols / decimationFactor);
+            if (realSpectrum) {
+                gaussianFilter.applyToWindow(spectrum, nRows, spectrumFiltered1, mainPeak1(1), mainPeak1(0));
+                gaussianFilter.applyToWindow(spectrum, nRows, spectrumFiltered2, mainPeak2(1), mainPeak2(0));
+            } else {
+                gaussianFilter.applyToWindow(spectrum, spectrumFiltered1, mainPeak1(1), mainPeak1(0));
+                gaussianFilter.applyToWindow(spectrum, spectrumFiltered2, mainPeak2(1), mainPeak2(0));
+            }
+        } else if (realSpectrum) {
+            spectrumFiltered1.resize(nRows, nCols);
+            spectrumFiltered2.resize(nRows, nCols);
+            gaussianFilter.applyTo(spectrum, nRows, spectrumFiltered1, mainPeak1(1), mainPeak1(0));
+            gaussianFilter.applyTo(spectrum, nRows, spectrumFiltered2, mainPeak2(1), mainPeak2(0));
+        } else {
+            spectrumFiltered1.resize(nRows, nCols);
+            spectrumFiltered2.resize(nRows, nCols);
+            gaussianFilter.applyTo(spectrum, spectrumFiltered1, mainPeak1(1), mainPeak1(0));
+            gaussianFilter.applyTo(spectrum, spectrumFiltered2, mainPeak2(1), mainPeak2(0));
+        }
+    }
 
-        unwrappedPhase2 = phase2.arg();
+    void PatternPhase::computePlanes() {
+        BasicFourierTransform<Real>& inverse = (decimationFactor > 1) ? ifftDecimated : ifft;
 
-        Spatial::quartersUnwrapPhase(unwrappedPhase2);
+        // Compute first plane phase from peak 1
+        inverse.compute(spectrumFiltered1, phase1);
+        plane1 = computePlane(phase1, mainPeak1);
 
-        plane2 = regressionPlane.compute(unwrappedPhase2);
+        this->pixelPeriod = plane1.getPixelicPeriod();
+
+        // Compute second plase from peak 2
+        inverse.compute(spectrumFiltered2, phase2);
+        plane2 = computePlane(phase2, mainPeak2);
+
+        trackablePlanes = peaksFound();
+        unwrappedPhasesOutdated = true;
 
 #ifndef USE_FFTW
         // plane1.setC(-plane1.getC());   // supprimé le 19/11/2022 quelle différence avec oouda fft ?
@@ -106,82 +374,171 @@ namespace vernier {
 #endif 
     }
 
-    void PatternPhase::computePhaseGradients(int& betaSign, int& gammaSign) {
+    PhasePlane PatternPhase::computePlane(Eigen::ArrayXXcr& phase, const Eigen::Vector3d& mainPeak) {
+        // The inverse transform of a shifted spectrum is modulated by (-1)^(row+col)
+        PhasePlane plane;
+        if (unwrapping) {
+            // The unwrapped columns are directly accumulated by the regression
+            Spatial::quartersUnwrapPhase(phase, true, regressionPlane, unwrapBuffers, threadPool);
+            plane = regressionPlane.computeAccumulated();
+        } else {
+            plane = regressionPlane.computeWrapped(phase, true);
+        }
+        if (decimationFactor == 1) {
+            return plane;
+        }
 
-        // Direction 1
-        int sideOffset = regressionPlane.getColOffset();
-        Eigen::ArrayXXd phaseCropped = unwrappedPhase1.block(sideOffset, sideOffset, unwrappedPhase1.rows() - 2 * sideOffset, unwrappedPhase1.cols() - 2 * sideOffset);
+        // Same carrier and offset as the ones added to the unwrapped decimated 
+        // phase (the carrier is zero at the origin of the regression)
+        double peakRow = mainPeak(1) - nRows / 2;
+        double peakCol = mainPeak(0) - nCols / 2;
+        double a = plane.getA() + 2 * PI * decimationFactor * peakCol / nCols;
+        double b = plane.getB() + 2 * PI * decimationFactor * peakRow / nRows;
+        double c;
+        if (unwrapping) {
+            int row = phase.rows() / 2;
+            int col = phase.cols() / 2;
+            double centerPhase = std::arg(((row + col) & 1) ? -phase(row, col) : phase(row, col));
+            c = plane.getC() + angleInPiPi(centerPhase + PI * (peakRow + peakCol)) - centerPhase;
+        } else {
+            c = angleInPiPi(plane.getC() + PI * (peakRow + peakCol));
+        }
+        return PhasePlane(a / decimationFactor, b / decimationFactor, c);
+    }
 
-        cv::Mat phase1img(phaseCropped.rows(), phaseCropped.cols(), CV_64FC1, phaseCropped.data());
-        cv::Mat phaseResult(phase1img.rows, phase1img.cols, CV_64FC1);
+    void PatternPhase::unwrapPhase(Eigen::ArrayXXcr& phase, Eigen::ArrayXXd& unwrappedPhase, const Eigen::Vector3d& mainPeak) {
+        // The inverse transform of a shifted spectrum is modulated by (-1)^(row+col)
+        Spatial::shiftedArg(phase, unwrappedPhase);
 
-        double a = plane1.getA();
-        double b = plane1.getB();
+        Spatial::quartersUnwrapPhase(unwrappedPhase, unwrapBuffers, threadPool);
 
-        cv::Mat phaseDerived(phase1img.rows - 1, phase1img.cols - 1, CV_64FC1);
-        cv::Mat sobelX, sobelY;
+        if (decimationFactor == 1) {
+            return;
+        }
 
-        for (int i = 0; i < phase1img.rows - 1; i++) {
-            for (int j = 0; j < phase1img.cols - 1; j++) {
-                double dXdU = -(phaseCropped(i + 1, j) - phaseCropped(i, j)) * a / (pow(a, 2) + pow(b, 2));
-                double dYdU = (phaseCropped(i, j + 1) - phaseCropped(i, j)) * b / (pow(a, 2) + pow(b, 2));
-                phaseDerived.at<double>(i, j) = dXdU + dYdU;
+        // The decimated phase is demodulated by the peak frequency, which is 
+        // added back after the unwrapping: the map is then the full phase 
+        // sampled every decimationFactor pixels around the center of the image
+        int rows = unwrappedPhase.rows();
+        int cols = unwrappedPhase.cols();
+        double peakRow = mainPeak(1) - nRows / 2;
+        double peakCol = mainPeak(0) - nCols / 2;
+        double centerPhase = unwrappedPhase(rows / 2, cols / 2);
+        double offset = angleInPiPi(centerPhase + PI * (peakRow + peakCol)) - centerPhase;
+        for (int col = 0; col < cols; col++) {
+            double colPhase = 2 * PI * decimationFactor * peakCol * (col - cols / 2) / nCols + offset;
+            for (int row = 0; row < rows; row++) {
+                unwrappedPhase(row, col) += colPhase + 2 * PI * decimationFactor * peakRow * (row - rows / 2) / nRows;
             }
         }
+    }
+
+    void PatternPhase::refinePeaks(Eigen::Vector3d& refinedPeak1, Eigen::Vector3d& refinedPeak2) {
+        refinedPeak1 = mainPeak1;
+        refinedPeak2 = mainPeak2;
+        if (realSpectrum) {
+            Spectrum::refinePeak(spectrum, nRows, refinedPeak1);
+            Spectrum::refinePeak(spectrum, nRows, refinedPeak2);
+        } else {
+            Spectrum::refinePeak(spectrum, refinedPeak1);
+            Spectrum::refinePeak(spectrum, refinedPeak2);
+        }
+    }
+
+    void PatternPhase::computeFastPlanes(const Eigen::ArrayXXd& image) {
+        Eigen::Vector3d refinedPeak1, refinedPeak2;
+        refinePeaks(refinedPeak1, refinedPeak2);
+        plane1 = Spectrum::peakPlane(image, refinedPeak1, peakRowPhasors, peakColumnSums);
+        plane2 = Spectrum::peakPlane(image, refinedPeak2, peakRowPhasors, peakColumnSums);
+        this->pixelPeriod = plane1.getPixelicPeriod();
+        trackablePlanes = peaksFound();
+    }
 
-        cv::Sobel(phaseDerived, sobelX, CV_64F, 1, 0);
-        double mean = cv::mean(sobelX)[0];
-        betaSign = (mean > 0) - (mean < 0);
-
-        //std::cout << "mean first direction SOBEL : " << mean << std::endl;
-        //cv::normalize(phaseDerived, phaseDerived, 1, 0, cv::NORM_MINMAX);
-        //cv::imshow("phase 1 derived", phaseDerived);
-
-        // Direction 2
-        phaseCropped = unwrappedPhase2.block(sideOffset, sideOffset, unwrappedPhase2.rows() - 2 * sideOffset, unwrappedPhase2.cols() - 2 * sideOffset);
-        cv::Mat phase2img(phaseCropped.rows(), phaseCropped.cols(), CV_64FC1, phaseCropped.data());
-        cv::Mat phase2HSV;
-        cv::Mat phase2BGR;
-        cv::normalize(phase2img, phase2img, 255, 0, cv::NORM_MINMAX);
-        phase2img.convertTo(phase2BGR, CV_8UC3);
-        cv::cvtColor(phase2BGR, phase2BGR, cv::COLOR_GRAY2BGR);
-
-        a = plane2.getA();
-        b = plane2.getB();
-
-        //cv::applyColorMap(phase2BGR, phase2HSV, cv::COLORMAP_VIRIDIS);
-        //cv::line(phase2HSV, cv::Point(phase2HSV.cols / 4, phase2HSV.rows / 2), cv::Point(3 * phase2HSV.cols / 4, phase2HSV.rows / 2), cv::Scalar(255, 255, 255), 1);
-        //cv::line(phase2HSV, cv::Point(phase2HSV.cols / 2, phase2HSV.rows / 4), cv::Point(phase2HSV.cols / 2, 3 * phase2HSV.rows / 4), cv::Scalar(255, 255, 255), 1);
-        //cv::arrowedLine(phase2HSV, cv::Point(phase2HSV.cols / 2, phase2HSV.rows / 2), cv::Point(3 * phase2HSV.cols / 4, phase2HSV.rows / 2), cv::Scalar(255, 255, 255), 3);
-        //cv::arrowedLine(phase2HSV, cv::Point(phase2HSV.cols / 2, phase2HSV.rows / 2), cv::Point(phase2HSV.cols / 2, 3 * phase2HSV.rows / 4), cv::Scalar(255, 255, 255), 3);
-        //cv::arrowedLine(phase2HSV, cv::Point(phase2HSV.cols / 2, phase2HSV.rows / 2), cv::Point(phase2HSV.cols / 2 + 30.0 / a, phase2HSV.rows / 2 + 30.0 / b), cv::Scalar(0, 0, 255), 3);
-        //cv::arrowedLine(phase2HSV, cv::Point(phase2HSV.cols / 2, phase2HSV.rows / 2), cv::Point(phase2HSV.cols / 2 - 30.0 / b, phase2HSV.rows / 2 + 30.0 / a), cv::Scalar(0, 0, 255), 3);
-        //cv::imshow("phase 2", phase2HSV);
-        //cv::imwrite("D:/Nextcloud2/classic3Dpatterns/analysis_scripts/perspectivePhaseEvolution/phaseMap.png", phase2HSV);
-
-        for (int i = 0; i < phase1img.rows - 1; i++) {
-            for (int j = 0; j < phase1img.cols - 1; j++) {
-                double dXdV = -(phaseCropped(i + 1, j) - phaseCropped(i, j)) * a / (pow(a, 2) + pow(b, 2));
-                double dYdV = (phaseCropped(i, j + 1) - phaseCropped(i, j)) * b / (pow(a, 2) + pow(b, 2));
-                phaseDerived.at<double>(i, j) = dXdV + dYdV;
+    void PatternPhase::computeFastPlanes(const Eigen::ArrayXXcd& image) {
+        Eigen::Vector3d refinedPeak1, refinedPeak2;
+        refinePeaks(refinedPeak1, refinedPeak2);
+        plane1 = Spectrum::peakPlane(image, refinedPeak1, peakRowPhasors, peakColumnSums);
+        plane2 = Spectrum::peakPlane(image, refinedPeak2, peakRowPhasors, peakColumnSums);
+        this->pixelPeriod = plane1.getPixelicPeriod();
+        trackablePlanes = peaksFound();
+    }
+
+    void PatternPhase::updateUnwrappedPhases() {
+        if (fastMode) {
+            throw Exception("The phase maps of PatternPhase are not computed in the fast mode.");
+        }
+        if (unwrappedPhasesOutdated) {
+            unwrapPhase(phase1, unwrappedPhase1, mainPeak1);
+            unwrapPhase(phase2, unwrappedPhase2, mainPeak2);
+            unwrappedPhasesOutdated = false;
+        }
+    }
+
+    // Derivative of the phase along the fringes at (row, col) of the cropped phase map
+    static inline double fringeDerivative(const Eigen::ArrayXXd& unwrappedPhase, int offset, int row, int col, double a, double b) {
+        double phase = unwrappedPhase(offset + row, offset + col);
+        double dX = -(unwrappedPhase(offset + row + 1, offset + col) - phase) * a;
+        double dY = (unwrappedPhase(offset + row, offset + col + 1) - phase) * b;
+        return (dX + dY) / (a * a + b * b);
+    }
+
+    // Number of times a line of an n lines map is counted by the [1 2 1] 
+    // smoothing of a 3x3 Sobel filter with reflected borders, summed over the map
+    static inline int sobelSmoothingWeight(int line, int n) {
+        if (line == 0 || line == n - 1) {
+            return 3;
+        }
+        return 4 + (line == 1) + (line == n - 2);
+    }
+
+    // Sum over the map of the 3x3 Sobel derivative (reflected borders, as 
+    // cv::Sobel) of the fringe derivative map, along the columns or along 
+    // the rows. The central differences telescope along the derivation axis, 
+    // so only the first two and the last two lines of the map are needed.
+    static double sumSobelFringeDerivative(const Eigen::ArrayXXd& unwrappedPhase, int offset, double a, double b, bool alongCols) {
+        int nRows = unwrappedPhase.rows() - 2 * offset - 1;
+        int nCols = unwrappedPhase.cols() - 2 * offset - 1;
+        double sum = 0.0;
+        if (alongCols) {
+            for (int row = 0; row < nRows; row++) {
+                double difference = fringeDerivative(unwrappedPhase, offset, row, nCols - 1, a, b) + fringeDerivative(unwrappedPhase, offset, row, nCols - 2, a, b)
+                        - fringeDerivative(unwrappedPhase, offset, row, 0, a, b) - fringeDerivative(unwrappedPhase, offset, row, 1, a, b);
+                sum += sobelSmoothingWeight(row, nRows) * difference;
+            }
+        } else {
+            for (int col = 0; col < nCols; col++) {
+                double difference = fringeDerivative(unwrappedPhase, offset, nRows - 1, col, a, b) + fringeDerivative(unwrappedPhase, offset, nRows - 2, col, a, b)
+                        - fringeDerivative(unwrappedPhase, offset, 0, col, a, b) - fringeDerivative(unwrappedPhase, offset, 1, col, a, b);
+                sum += sobelSmoothingWeight(col, nCols) * difference;
             }
         }
+        return sum;
+    }
+
+    void PatternPhase::computePhaseGradients(int& betaSign, int& gammaSign) {
+        updateUnwrappedPhases();
 
-        cv::Sobel(phaseDerived, sobelY, CV_64F, 0, 1);
-        double mean2 = cv::mean(sobelY)[0];
+        // Only the signs of the mean second derivatives are needed, they are 
+        // reduced from the borders of the cropped phase maps without any 
+        // derivative image
+        int sideOffset = regressionPlane.getColOffset();
+        double sum1 = sumSobelFringeDerivative(unwrappedPhase1, sideOffset, plane1.getA(), plane1.getB(), true);
+        betaSign = (sum1 > 0) - (sum1 < 0);
 
-        //std::cout << "mean second direction SOBEL : " << mean2 << std::endl;
-        gammaSign = (mean2 > 0) - (mean2 < 0);
+        double sum2 = sumSobelFringeDerivative(unwrappedPhase2, sideOffset, plane2.getA(), plane2.getB(), false);
+        gammaSign = (sum2 > 0) - (sum2 < 0);
     }
 
     void PatternPhase::computeWeakPerspective(Eigen::ArrayXXd& patternArray, int& betaSign, int& gammaSign, double approxPixelPeriod) {
-        spatial.resize(patternArray.rows(), patternArray.cols());
-        spatial.real() = patternArray.array();
-        compute(spatial);
+        // The real spectrum gives the same planes as the one of the complex image
+        compute(patternArray);
     }
 
     void PatternPhase::computeWeakPerspective(Eigen::ArrayXXcd& patternArray, int& betaSign, int& gammaSign, double approxPixelPeriod) {
-        fft.compute(patternArray, spectrum);
+        realSpectrum = false;
+        centeredSpectrum = false;
+        spatial = patternArray.cast<std::complex<Real> >();
+        fft.compute(spatial, spectrum);
 
         Spectrum::shift(spectrum, spectrumShifted);
         spectrumFiltered1 = spectrumShifted;
@@ -201,9 +558,8 @@ namespace vernier {
         ifft.compute(spectrumFiltered1, phase1);
         Spatial::shift(phase1);
 
-        unwrappedPhase1 = phase1.array().arg();
-        Eigen::ArrayXXd phase1Wrapped = unwrappedPhase1;
-        Spatial::quartersUnwrapPhase(unwrappedPhase1);
+        unwrappedPhase1 = phase1.array().arg().cast<double>();
+        Spatial::quartersUnwrapPhase(unwrappedPhase1, unwrapBuffers, threadPool);
 
 
         plane1 = regressionPlane.compute(unwrappedPhase1);
@@ -212,34 +568,11 @@ namespace vernier {
             this->pixelPeriod = plane1.getPixelicPeriod();
         }
 
+        // Signs of the mean Sobel derivatives of the fringe derivative maps, 
+        // reduced from the borders of the cropped maps (see computePhaseGradients)
         int sideOffset = regressionPlane.getColOffset();
-        Eigen::ArrayXXd phaseCropped = unwrappedPhase1.block(sideOffset, sideOffset, unwrappedPhase1.rows() - 2 * sideOffset, unwrappedPhase1.cols() - 2 * sideOffset);
-
-        cv::Mat phase1img(phaseCropped.rows(), phaseCropped.cols(), CV_64FC1, phaseCropped.data());
-        cv::Mat phaseResult(phase1img.rows, phase1img.cols, CV_64FC1);
-
-        double a = plane1.getA();
-        double b = plane1.getB();
-
-        cv::Mat phaseDerived(phase1img.rows - 1, phase1img.cols - 1, CV_64FC1);
-        cv::Mat sobelX, sobelY;
-
-        for (int i = 0; i < phase1img.rows - 1; i++) {
-            for (int j = 0; j < phase1img.cols - 1; j++) {
-                double dXdU = -(phaseCropped(i + 1, j) - phaseCropped(i, j)) * a / (pow(a, 2) + pow(b, 2));
-                double dYdU = (phaseCropped(i, j + 1) - phaseCropped(i, j)) * b / (pow(a, 2) + pow(b, 2));
-                phaseDerived.at<double>(i, j) = dXdU + dYdU;
-            }
-        }
-
-        cv::Sobel(phaseDerived, sobelX, CV_64F, 1, 0);
-        double mean = cv::mean(sobelX)[0];
-        betaSign = (mean > 0) - (mean < 0);
-
-        //std::cout << "mean first direction SOBEL : " << mean << std::endl;
-        //cv::normalize(phaseDerived, phaseDerived, 1, 0, cv::NORM_MINMAX);
-        //cv::imshow("phase 1 derived", phaseDerived);
-
+        double sum1 = sumSobelFringeDerivative(unwrappedPhase1, sideOffset, plane1.getA(), plane1.getB(), true);
+        betaSign = (sum1 > 0) - (sum1 < 0);
 
 
         // Quarter 2
@@ -247,50 +580,20 @@ namespace vernier {
         ifft.compute(spectrumFiltered2, phase1);
         Spatial::shift(phase1);
 
-        unwrappedPhase2 = phase1.array().arg();
-        Spatial::quartersUnwrapPhase(unwrappedPhase2);
+        unwrappedPhase2 = phase1.array().arg().cast<double>();
+        Spatial::quartersUnwrapPhase(unwrappedPhase2, unwrapBuffers, threadPool);
 
         plane2 = regressionPlane.compute(unwrappedPhase2);
 
-        phaseCropped = unwrappedPhase2.block(sideOffset, sideOffset, unwrappedPhase2.rows() - 2 * sideOffset, unwrappedPhase2.cols() - 2 * sideOffset);
-        cv::Mat phase2img(phaseCropped.rows(), phaseCropped.cols(), CV_64FC1, phaseCropped.data());
-        cv::Mat phase2HSV;
-        cv::Mat phase2BGR;
-        cv::normalize(phase2img, phase2img, 255, 0, cv::NORM_MINMAX);
-        phase2img.convertTo(phase2BGR, CV_8UC3);
-        cv::cvtColor(phase2BGR, phase2BGR, cv::COLOR_GRAY2BGR);
-
-        a = plane2.getA();
-        b = plane2.getB();
-
-        //cv::applyColorMap(phase2BGR, phase2HSV, cv::COLORMAP_VIRIDIS);
-        //cv::line(phase2HSV, cv::Point(phase2HSV.cols / 4, phase2HSV.rows / 2), cv::Point(3 * phase2HSV.cols / 4, phase2HSV.rows / 2), cv::Scalar(255, 255, 255), 1);
-        //cv::line(phase2HSV, cv::Point(phase2HSV.cols / 2, phase2HSV.rows / 4), cv::Point(phase2HSV.cols / 2, 3 * phase2HSV.rows / 4), cv::Scalar(255, 255, 255), 1);
-        //cv::arrowedLine(phase2HSV, cv::Point(phase2HSV.cols / 2, phase2HSV.rows / 2), cv::Point(3 * phase2HSV.cols / 4, phase2HSV.rows / 2), cv::Scalar(255, 255, 255), 3);
-        //cv::arrowedLine(phase2HSV, cv::Point(phase2HSV.cols / 2, phase2HSV.rows / 2), cv::Point(phase2HSV.cols / 2, 3 * phase2HSV.rows / 4), cv::Scalar(255, 255, 255), 3);
-        //cv::arrowedLine(phase2HSV, cv::Point(phase2HSV.cols / 2, phase2HSV.rows / 2), cv::Point(phase2HSV.cols / 2 + 30.0 / a, phase2HSV.rows / 2 + 30.0 / b), cv::Scalar(0, 0, 255), 3);
-        //cv::arrowedLine(phase2HSV, cv::Point(phase2HSV.cols / 2, phase2HSV.rows / 2), cv::Point(phase2HSV.cols / 2 - 30.0 / b, phase2HSV.rows / 2 + 30.0 / a), cv::Scalar(0, 0, 255), 3);
-        //cv::imshow("phase 2", phase2HSV);
-        //cv::imwrite("D:/Nextcloud2/classic3Dpatterns/analysis_scripts/perspectivePhaseEvolution/phaseMap.png", phase2HSV);
-
-        for (int i = 0; i < phase1img.rows - 1; i++) {
-            for (int j = 0; j < phase1img.cols - 1; j++) {
-                double dXdV = -(phaseCropped(i + 1, j) - phaseCropped(i, j)) * a / (pow(a, 2) + pow(b, 2));
-                double dYdV = (phaseCropped(i, j + 1) - phaseCropped(i, j)) * b / (pow(a, 2) + pow(b, 2));
-                phaseDerived.at<double>(i, j) = dXdV + dYdV;
-            }
-        }
-
-        cv::Sobel(phaseDerived, sobelY, CV_64F, 0, 1);
-        double mean2 = cv::mean(sobelY)[0];
-
-        //std::cout << "mean second direction SOBEL : " << mean2 << std::endl;
-        gammaSign = (mean2 > 0) - (mean2 < 0);
+        double sum2 = sumSobelFringeDerivative(unwrappedPhase2, sideOffset, plane2.getA(), plane2.getB(), false);
+        gammaSign = (sum2 > 0) - (sum2 < 0);
     }
 
     void PatternPhase::computeQRCode(Eigen::ArrayXXcd& patternArray) {
 
-        Eigen::ArrayXXcd meanPattern = patternArray - patternArray.mean();
+        meanPattern = (patternArray - patternArray.mean()).cast<std::complex<Real> >();
+        realSpectrum = false;
+        centeredSpectrum = false;
         fft.compute(meanPattern, spectrum);
         Spectrum::shift(spectrum, spectrumShifted);
         spectrumFiltered1 = spectrumShifted;
@@ -302,7 +605,7 @@ namespace vernier {
         gaussianFilter.applyTo(spectrumFiltered1, mainPeak1(1), mainPeak1(0));
         ifft.compute(spectrumFiltered1, phase1);
         Spatial::shift(phase1);
-        unwrappedPhase1 = phase1.array().arg();
+        unwrappedPhase1 = phase1.array().arg().cast<double>();
 
         ////__________
         ////affichage
@@ -319,14 +622,14 @@ namespace vernier {
         ////_____________
 
 
-        Spatial::quartersUnwrapPhase(unwrappedPhase1);
+        Spatial::quartersUnwrapPhase(unwrappedPhase1, unwrapBuffers, threadPool);
         //        phaseCropped = phase1.block(sideOffset, sideOffset, phase1.rows() - 2 * sideOffset, phase1.cols() - 2 * sideOffset);
         this->plane1 = regressionPlane.compute(unwrappedPhase1);
 
         gaussianFilter.applyTo(spectrumFiltered2, mainPeak2(1), mainPeak2(0));
         ifft.compute(spectrumFiltered2, phase1);
         Spatial::shift(phase1);
-        unwrappedPhase2 = phase1.array().arg();
+        unwrappedPhase2 = phase1.array().arg().cast<double>();
 
         //Eigen::MatrixXd intermediaryMatrix;
         //cv::Mat phaseImage;
@@ -346,75 +649,100 @@ namespace vernier {
         //cv::imwrite("phaseImage2.png", phaseImage);
         ////_________
 
-        Spatial::quartersUnwrapPhase(unwrappedPhase2);
+        Spatial::quartersUnwrapPhase(unwrappedPhase2, unwrapBuffers, threadPool);
         //        phaseCropped = phase2.block(sideOffset, sideOffset, phase2.rows() - 2 * sideOffset, phase2.cols() - 2 * sideOffset);
         this->plane2 = regressionPlane.compute(unwrappedPhase2);
 
     }
 
+    double PatternPhase::gaussianResidual(double sigma) {
+        // Sum of squares of the differences between the spectrum modulus and 
+        // its Gaussian model around mainPeak1, minus the sum of squares of the 
+        // spectrum modulus: both only differ inside the kernel window, so the 
+        // residual only depends on sigma through this window
+        int peakRow = mainPeak1(1);
+        int peakCol = mainPeak1(0);
+        int halfSize = (int) (sigma * sqrt(-2 * log(1e-16)));
+        int rowMin = std::max(0, peakRow - halfSize);
+        int rowMax = std::min((int) spectrumShifted.rows() - 1, peakRow + halfSize);
+        int colMin = std::max(0, peakCol - halfSize);
+        int colMax = std::min((int) spectrumShifted.cols() - 1, peakCol + halfSize);
+        double peakModulus = std::abs(spectrumShifted(peakRow, peakCol));
+        double sigma2 = 2 * sigma * sigma;
+        double residual = 0.0;
+        for (int col = colMin; col <= colMax; col++) {
+            double dCol = col - peakCol;
+            for (int row = rowMin; row <= rowMax; row++) {
+                double dRow = row - peakRow;
+                double model = peakModulus * exp(-(dRow * dRow + dCol * dCol) / sigma2);
+                residual += model * (model - 2 * std::abs(spectrumShifted(row, col)));
+            }
+        }
+        return residual;
+    }
+
     double PatternPhase::computeFirst(Eigen::ArrayXXcd& patternArray, double& pixelPeriod) {
-        Eigen::ArrayXXcd meanPattern = patternArray - patternArray.mean();
+        meanPattern = (patternArray - patternArray.mean()).cast<std::complex<Real> >();
+        realSpectrum = false;
+        centeredSpectrum = false;
         fft.compute(meanPattern, spectrum);
         Spectrum::shift(spectrum, spectrumShifted);
         spectrumFiltered1 = spectrumShifted;
-        Eigen::ArrayXXcd spectrumShift2(patternArray.rows(), patternArray.cols());
-        Eigen::ArrayXXcd gaussian2D(patternArray.rows(), patternArray.cols());
-        gaussian2D.setConstant(1);
-        Eigen::ArrayXXcd Jcriterion(patternArray.rows(), patternArray.cols());
-
         Spectrum::mainPeakQuarter(spectrumShifted, mainPeak1, mainPeak2);
 
-        //std::cout << "main peak : " << mainPeak1(1) << " ; " << mainPeak1(0) << std::endl;
-
-        double sigma = 0.333;
-        spectrumShift2 = spectrumShifted;
-
-        gaussianFilter.setSigma(sigma);
-        gaussianFilter.applyTo(gaussian2D, mainPeak1(1), mainPeak1(0));
-
-        gaussian2D *= spectrumShift2(mainPeak1(1), mainPeak1(0));
-
-        gaussian2D = gaussian2D.abs();
-        spectrumShift2 = spectrumShift2.abs();
-
-        spectrumShift2 -= gaussian2D;
-
-        Jcriterion = spectrumShift2 * spectrumShift2;
-
-        double meanJPrev = Jcriterion.abs().sum() * 10;
-
-        double meanJ = 0;
-        while (true) {
-            sigma += 0.001;
-
-            spectrumShift2 = spectrumShifted;
-            gaussian2D.setConstant(1);
-            gaussianFilter.setSigma(sigma);
-            gaussianFilter.applyTo(gaussian2D, mainPeak1(1), mainPeak1(0));
-
-            gaussian2D *= spectrumShift2(mainPeak1(1), mainPeak1(0));
-
-            gaussian2D = gaussian2D.abs();
-
-            spectrumShift2 -= gaussian2D;
-
-            Jcriterion = spectrumShift2 * spectrumShift2;
-
-            meanJ = Jcriterion.abs().sum();
-
-            if (meanJ > meanJPrev) break;
-            else {
-                meanJPrev = meanJ;
+        // The width of the Gaussian model of the main peak is searched by 
+        // bracketing the minimum of the residual from sigma = 0.333 with a 
+        // doubling step, then by golden-section search down to 0.001
+        double sigmaMax = 0.5 * std::min(spectrumShifted.rows(), spectrumShifted.cols());
+        double step = 0.001;
+        double sigmaLow = 0.333;
+        double sigmaMid = sigmaLow + step;
+        double residualLow = gaussianResidual(sigmaLow);
+        double residualMid = gaussianResidual(sigmaMid);
+        double sigmaHigh;
+        if (residualMid >= residualLow) {
+            sigmaHigh = sigmaMid;
+            sigmaMid = sigmaLow;
+        } else {
+            while (true) {
+                step *= 2;
+                sigmaHigh = std::min(sigmaMid + step, sigmaMax);
+                double residualHigh = gaussianResidual(sigmaHigh);
+                if (residualHigh > residualMid || sigmaHigh >= sigmaMax) break;
+                sigmaLow = sigmaMid;
+                sigmaMid = sigmaHigh;
+                residualMid = residualHigh;
             }
+        }
 
-            //std::cout << "mean criterion : " <<  meanJ  << " ; sigma : " << sigma << std::endl;
+        const double invPhi = 0.5 * (sqrt(5.0) - 1);
+        double sigma1 = sigmaHigh - invPhi * (sigmaHigh - sigmaLow);
+        double sigma2 = sigmaLow + invPhi * (sigmaHigh - sigmaLow);
+        double residual1 = gaussianResidual(sigma1);
+        double residual2 = gaussianResidual(sigma2);
+        while (sigmaHigh - sigmaLow > 0.001) {
+            if (residual1 < residual2) {
+                sigmaHigh = sigma2;
+                sigma2 = sigma1;
+                residual2 = residual1;
+                sigma1 = sigmaHigh - invPhi * (sigmaHigh - sigmaLow);
+                residual1 = gaussianResidual(sigma1);
+            } else {
+                sigmaLow = sigma1;
+                sigma1 = sigma2;
+                residual1 = residual2;
+                sigma2 = sigmaLow + invPhi * (sigmaHigh - sigmaLow);
+                residual2 = gaussianResidual(sigma2);
+            }
         }
+        double sigma = 0.5 * (sigmaLow + sigmaHigh);
+        setSigma(sigma);
 
         gaussianFilter.applyTo(spectrumFiltered1, mainPeak1(1), mainPeak1(0));
         ifft.compute(spectrumFiltered1, phase1);
         Spatial::shift(phase1);
-        unwrappedPhase1 = phase1.array().arg();
-        Spatial::quartersUnwrapPhase(unwrappedPhase1);
+        unwrappedPhase1 = phase1.array().arg().cast<double>();
+        Spatial::quartersUnwrapPhase(unwrappedPhase1, unwrapBuffers, threadPool);
         //        phaseCropped = phase1.block(sideOffset, sideOffset, phase1.rows() - 2 * sideOffset, phase1.cols() - 2 * sideOffset);
         this->plane1 = regressionPlane.compute(unwrappedPhase1);
 
@@ -431,8 +759,15 @@ namespace vernier {
     }
 
     cv::Mat PatternPhase::getPeaksImage() {
+        if (realSpectrum) {
+            Spectrum::shiftHermitian(spectrum, getNRows(), spectrumShifted);
+        } else if (centeredSpectrum) {
+            spectrumShifted = spectrum;
+        } else {
+            Spectrum::shift(spectrum, spectrumShifted);
+        }
         int offsetMin = 10.0;
-        double max = spectrumShifted.block(spectrumShifted.rows() / 2 - offsetMin / 2, spectrumShifted.cols() / 2 - offsetMin / 2, offsetMin, offsetMin).abs().maxCoeff();
+        Real max = spectrumShifted.block(spectrumShifted.rows() / 2 - offsetMin / 2, spectrumShifted.cols() / 2 - offsetMin / 2, offsetMin, offsetMin).abs().maxCoeff();
         spectrumShifted.block(spectrumShifted.rows() / 2 - offsetMin / 2, spectrumShifted.cols() / 2 - offsetMin / 2, offsetMin, offsetMin) /= max;
 
         cv::Mat image = array2image(spectrumShifted);
@@ -461,24 +796,31 @@ namespace vernier {
     }
 
     cv::Mat PatternPhase::getFringesImage() {
-        cv::Mat image = array2image(spatial);
+        cv::Mat image = getImage();
+        Eigen::ArrayXXd wrappedPhase1 = getPhase1();
+        Eigen::ArrayXXd wrappedPhase2 = getPhase2();
 
+        // The decimated maps are drawn with blocks of decimationFactor pixels 
+        // (the sizes of the image are multiples of the factor)
+        int D = decimationFactor;
         for (int row = 0; row < image.rows; ++row) {
             uchar *dst = image.ptr<uchar>(row);
+            int phaseRow = row / D;
             for (int col = 0; col < image.cols; ++col) {
-                uchar intensity = (uchar) (40 * std::pow((cos(std::arg(phase1(row, col))) + 1), 2));
+                int phaseCol = col / D;
+                uchar intensity = (uchar) (40 * std::pow((cos(wrappedPhase1(phaseRow, phaseCol)) + 1), 2));
                 uchar red = dst[4 * col + 2];
                 if (intensity > red)
                     dst[4 * col + 2] = intensity;
 
-                intensity = (uchar) (40 * std::pow((cos(std::abs(std::arg(phase2(row, col)))) + 1), 2));
+                intensity = (uchar) (40 * std::pow((cos(std::abs(wrappedPhase2(phaseRow, phaseCol))) + 1), 2));
                 uchar green = dst[4 * col + 1];
                 if (intensity > green)
                     dst[4 * col + 1] = (uchar) intensity;
             }
         }
 
-        cv::rectangle(image, cv::Rect(regressionPlane.getColOffset(), regressionPlane.getRowOffset(), regressionPlane.getNColsCropped(), regressionPlane.getNRowsCropped()), cv::Scalar(255, 0, 0));
+        cv::rectangle(image, cv::Rect(D * regressionPlane.getColOffset(), D * regressionPlane.getRowOffset(), D * regressionPlane.getNColsCropped(), D * regressionPlane.getNRowsCropped()), cv::Scalar(255, 0, 0));
 
         int cx = image.cols / 2;
         int cy = image.rows / 2;
@@ -495,36 +837,58 @@ namespace vernier {
     }
 
     cv::Mat PatternPhase::getImage() {
-        cv::Mat image = array2image(spatial);
-        return image;
+        if (realSpectrum) {
+            // The real image is not kept, it is recovered from its half spectrum
+            Eigen::ArrayXXr image;
+            ifftReal.resize(getNRows(), getNCols(), FFTW_BACKWARD, true);
+            ifftReal.compute(spectrum, image);
+            return array2image(image);
+        }
+        // The complex image is kept modulated by (-1)^(row+col)
+        Eigen::ArrayXXcr image = spatial;
+        Spatial::shift(image);
+        return array2image(image);
     }
 
-    Eigen::ArrayXXcd & PatternPhase::getSpectrum() {
+    Eigen::ArrayXXcr & PatternPhase::getSpectrum() {
+        if (realSpectrum) {
+            Spectrum::shiftHermitian(spectrum, getNRows(), spectrumShifted);
+        } else if (centeredSpectrum) {
+            spectrumShifted = spectrum;
+        } else {
+            Spectrum::shift(spectrum, spectrumShifted);
+        }
         return spectrumShifted;
     }
 
-    Eigen::ArrayXXcd & PatternPhase::getSpectrumPeak1() {
+    Eigen::ArrayXXcr & PatternPhase::getSpectrumPeak1() {
         return spectrumFiltered1;
     }
 
-    Eigen::ArrayXXcd & PatternPhase::getSpectrumPeak2() {
+    Eigen::ArrayXXcr & PatternPhase::getSpectrumPeak2() {
         return spectrumFiltered2;
     }
 
     Eigen::ArrayXXd & PatternPhase::getUnwrappedPhase1() {
+        updateUnwrappedPhases();
         return unwrappedPhase1;
     }
 
     Eigen::ArrayXXd & PatternPhase::getUnwrappedPhase2() {
+        updateUnwrappedPhases();
         return unwrappedPhase2;
     }
 
     Eigen::ArrayXXd PatternPhase::getPhase1() {
-        return phase1.arg();
+        Eigen::ArrayXXd phase;
+        Spatial::shiftedArg(phase1, phase);
+        return phase;
     }
 
     Eigen::ArrayXXd PatternPhase::getPhase2() {
-        return phase2.arg();
+        Eigen::ArrayXXd phase;
+        Spatial::shiftedArg(phase2, phase);
+        return phase;
     }
 
     PhasePlane PatternPhase::getPlane1() {
@@ -535,6 +899,14 @@ namespace vernier {
         return plane2;
     }
 
+    PhasePlane PatternPhase::getBatchPlane1(int i) {
+        return batchPlanes1.at(i);
+    }
+
+    PhasePlane PatternPhase::getBatchPlane2(int i) {
+        return batchPlanes2.at(i);
+    }
+
     void PatternPhase::setCropFactor(double cropFactor) {
         regressionPlane.setCropFactor(cropFactor);
     }
@@ -549,6 +921,7 @@ namespace vernier {
 
     void PatternPhase::setSigma(double sigma) {
         gaussianFilter.setSigma(sigma);
+        updateDecimationFactor();
     }
 
     double PatternPhase::getSigma() {
@@ -564,12 +937,109 @@ namespace vernier {
         return pixelPeriod;
     }
 
+    void PatternPhase::setPixelPeriodBounds(double minPixelPeriod, double maxPixelPeriod) {
+        if (!(minPixelPeriod == 0.0 && maxPixelPeriod == 0.0) && (minPixelPeriod <= 0.0 || maxPixelPeriod < minPixelPeriod)) {
+            throw Exception("The pixel period bounds of PatternPhase must be positive and sorted.");
+        }
+        this->minPixelPeriod = minPixelPeriod;
+        this->maxPixelPeriod = maxPixelPeriod;
+        updateAnnulus();
+    }
+
+    double PatternPhase::getMinPixelPeriod() {
+        return minPixelPeriod;
+    }
+
+    double PatternPhase::getMaxPixelPeriod() {
+        return maxPixelPeriod;
+    }
+
+    void PatternPhase::setDecimation(int maxDecimationFactor) {
+        if (maxDecimationFactor < 1) {
+            throw Exception("The decimation factor of PatternPhase must be positive.");
+        }
+        this->maxDecimationFactor = maxDecimationFactor;
+        updateDecimationFactor();
+    }
+
+    int PatternPhase::getDecimationFactor() {
+        return decimationFactor;
+    }
+
+    void PatternPhase::setPyramidFactor(int pyramidFactor) {
+        if (pyramidFactor < 1) {
+            throw Exception("The pyramid factor of PatternPhase must be positive.");
+        }
+        this->pyramidFactor = pyramidFactor;
+        updatePyramid();
+    }
+
+    int PatternPhase::getPyramidFactor() {
+        return pyramidFactor;
+    }
+
+    void PatternPhase::setTracking(bool tracking, int radius) {
+        if (radius < 1) {
+            throw Exception("The tracking radius of PatternPhase must be positive.");
+        }
+        this->tracking = tracking;
+        this->trackingRadius = radius;
+        this->trackablePlanes = false;
+    }
+
+    bool PatternPhase::isTracking() {
+        return tracking;
+    }
+
+    void PatternPhase::setUnwrapping(bool unwrapping) {
+        this->unwrapping = unwrapping;
+    }
+
+    bool PatternPhase::isUnwrapping() {
+        return unwrapping;
+    }
+
+    void PatternPhase::setFastMode(bool fastMode) {
+        this->fastMode = fastMode;
+    }
+
+    bool PatternPhase::isFastMode() {
+        return fastMode;
+    }
+
+    void PatternPhase::setPlannerFlags(unsigned plannerFlags) {
+        fft.setPlannerFlags(plannerFlags);
+        ifft.setPlannerFlags(plannerFlags);
+        fftReal.setPlannerFlags(plannerFlags);
+        ifftReal.setPlannerFlags(plannerFlags);
+        fftBatch.setPlannerFlags(plannerFlags);
+        ifftBatch.setPlannerFlags(plannerFlags);
+        ifftDecimated.setPlannerFlags(plannerFlags);
+        fftBinned.setPlannerFlags(plannerFlags);
+    }
+
+    void PatternPhase::setNumberOfThreads(int nThreads) {
+        if (nThreads < 1) {
+            throw Exception("The number of threads of PatternPhase must be positive.");
+        }
+        this->nThreads = nThreads;
+        threadPool.setNumberOfThreads(nThreads);
+        fft.setNumberOfThreads(nThreads);
+        ifft.setNumberOfThreads(nThreads);
+        fftReal.setNumberOfThreads(nThreads);
+        ifftReal.setNumberOfThreads(nThreads);
+        fftBatch.setNumberOfThreads(nThreads);
+        ifftBatch.setNumberOfThreads(nThreads);
+        ifftDecimated.setNumberOfThreads(nThreads);
+        fftBinned.setNumberOfThreads(nThreads);
+    }
+
     int PatternPhase::getNRows() {
-        return spectrum.rows();
+        return nRows;
     }
 
     int PatternPhase::getNCols() {
-        return spectrum.cols();
+        return nCols;
     }
 
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -136,6 +136,9 @@ namespace vernier {
 
 
     void PeriodicPatternDetector::setPhaseGradientMode(bool isPerspective) {
+        if (!isPerspective && patternPhase.isFastMode()) {
+            throw Exception("The phase gradients need the phase maps, they cannot be computed in the fast mode.");
+        }
         this->computePhaseGradient = !isPerspective;
     }
 
@@ -155,6 +158,10 @@ namespace vernier {
         this->patternPhase.setPixelPeriod(pixelPeriod);
     }
 
+    void PeriodicPatternDetector::setPixelPeriodBounds(double minPixelPeriod, double maxPixelPeriod) {
+        this->patternPhase.setPixelPeriodBounds(minPixelPeriod, maxPixelPeriod);
+    }
+
     void PeriodicPatternDetector::setSigma(double sigma) {
         this->patternPhase.setSigma(sigma);
     }
@@ -167,6 +174,37 @@ namespace vernier {
         this->patternPhase.setCropFactor(cropFactor);
     }
 
+    void PeriodicPatternDetector::setPlannerFlags(unsigned plannerFlags) {
+        this->patternPhase.setPlannerFlags(plannerFlags);
+    }
+
+    void PeriodicPatternDetector::setNumberOfThreads(int nThreads) {
+        this->patternPhase.setNumberOfThreads(nThreads);
+    }
+
+    void PeriodicPatternDetector::setDecimation(int maxDecimationFactor) {
+        this->patternPhase.setDecimation(maxDecimationFactor);
+    }
+
+    void PeriodicPatternDetector::setPyramidFactor(int pyramidFactor) {
+        this->patternPhase.setPyramidFactor(pyramidFactor);
+    }
+
+    void PeriodicPatternDetector::setTracking(bool tracking) {
+        this->patternPhase.setTracking(tracking);
+    }
+
+    void PeriodicPatternDetector::setUnwrapping(bool unwrapping) {
+        this->patternPhase.setUnwrapping(unwrapping);
+    }
+
+    void PeriodicPatternDetector::setFastMode(bool fastMode) {
+        if (fastMode && computePhaseGradient) {
+            throw Exception("The fast mode does not compute the phase maps needed by the phase gradients.");
+        }
+        this->patternPhase.setFastMode(fastMode);
+    }
+
     void PeriodicPatternDetector::setDouble(const std::string & attribute, double value) {
         if (attribute == "physicalPeriod") {
             setPhysicalPeriod(value);
@@ -174,6 +212,14 @@ namespace vernier {
             setSigma(value);
         } else if (attribute == "pixelPeriod") {
             setPixelPeriod(value);
+        } else if (attribute == "minPixelPeriod") {
+            // unbounded largest period until it is set
+            double maxPixelPeriod = patternPhase.getMaxPixelPeriod();
+            setPixelPeriodBounds(value, maxPixelPeriod > 0.0 ? maxPixelPeriod : HUGE_VAL);
+        } else if (attribute == "maxPixelPeriod") {
+            // smallest period at the Nyquist limit until it is set
+            double minPixelPeriod = patternPhase.getMinPixelPeriod();
+            setPixelPeriodBounds(minPixelPeriod > 0.0 ? minPixelPeriod : 2.0, value);
         } else if (attribute == "cropFactor") {
             setCropFactor(value);
         } else {
@@ -188,6 +234,10 @@ namespace vernier {
             return patternPhase.getSigma();
         } else if (attribute == "approxPixelPeriod") {
             return patternPhase.getPixelPeriod();
+        } else if (attribute == "minPixelPeriod") {
+            return patternPhase.getMinPixelPeriod();
+        } else if (attribute == "maxPixelPeriod") {
+            return patternPhase.getMaxPixelPeriod();
         } else {
             return PatternDetector::getDouble(attribute);
         }
@@ -210,6 +260,12 @@ namespace vernier {
             return computePhaseGradient;
         } else if (attribute == "phaseGradientMode") {
             return computePhaseGradient;
+        } else if (attribute == "tracking") {
+            return patternPhase.isTracking();
+        } else if (attribute == "unwrapping") {
+            return patternPhase.isUnwrapping();
+        } else if (attribute == "fastMode") {
+            return patternPhase.isFastMode();
         } else {
             return PatternDetector::getBool(attribute);
         }
@@ -220,8 +276,34 @@ namespace vernier {
             computePhaseGradient = value;
         } else if (attribute == "phaseGradientMode") {
             computePhaseGradient = value;
+        } else if (attribute == "tracking") {
+            setTracking(value);
+        } else if (attribute == "unwrapping") {
+            setUnwrapping(value);
+        } else if (attribute == "fastMode") {
+            setFastMode(value);
         } else {
             PatternDetector::setBool(attribute, value);
         }
     }
+
+    void PeriodicPatternDetector::setString(const std::string & attribute, std::string value) {
+        if (attribute == "fftPlanner") {
+            setPlannerFlags(FourierTransform::getPlannerFlags(value));
+        } else {
+            PatternDetector::setString(attribute, value);
+        }
+    }
+
+    void PeriodicPatternDetector::setInt(const std::string & attribute, int value) {
+        if (attribute == "fftThreads") {
+            setNumberOfThreads(value);
+        } else if (attribute == "decimation") {
+            setDecimation(value);
+        } else if (attribute == "pyramidFactor") {
+            setPyramidFactor(value);
+        } else {
+            PatternDetector::setInt(attribute, value);
+        }
+    }
 }
\ No newline at end of file
@@ -28,27 +28,46 @@ namespace vernier {
             cols -= 2 * colOffset;
             rows -= 2 * rowOffset;
 
-            phaseCropped.resize(rows, cols);
-
-            meshRow = Eigen::VectorXd::LinSpaced(rows, -rows / 2, rows / 2 - 1).replicate(1, cols);
-            meshCol = Eigen::RowVectorXd::LinSpaced(cols, -cols / 2, cols / 2 - 1).replicate(rows, 1);
-
-            matMean << meshCol.cwiseProduct(meshCol).mean(), meshCol.cwiseProduct(meshRow).mean(), meshCol.mean(),
-                    meshCol.cwiseProduct(meshRow).mean(), meshRow.cwiseProduct(meshRow).mean(), meshRow.mean(),
-                    meshCol.mean(), meshRow.mean(), 1;
+            rowCoordinates = Eigen::VectorXd::LinSpaced(rows, -rows / 2, rows / 2 - 1);
+            colCoordinates = Eigen::VectorXd::LinSpaced(cols, -cols / 2, cols / 2 - 1);
+            colSums.resize(cols);
+            colRowMoments.resize(cols);
+            rowPhasors.resize(rows);
+            colPhasors.resize(cols);
+            demodulatedColumn.resize(rows);
+
+            // The mesh of the regression is separable: its moments are the 
+            // products of the moments of the row and column coordinates
+            double rowMean = rowCoordinates.mean();
+            double colMean = colCoordinates.mean();
+            matMean << colCoordinates.squaredNorm() / cols, colMean * rowMean, colMean,
+                    colMean * rowMean, rowCoordinates.squaredNorm() / rows, rowMean,
+                    colMean, rowMean, 1;
         }
     }
 
     PhasePlane RegressionPlane::compute(const Eigen::ArrayXXd & unwrappedPhase) {
         resize(unwrappedPhase.rows(), unwrappedPhase.cols());
+        for (int col = 0; col < colSums.size(); col++) {
+            accumulateColumn(col, &unwrappedPhase(rowOffset, colOffset + col));
+        }
+        return computeAccumulated();
+    }
+
+    void RegressionPlane::accumulateColumn(int col, const double* column) {
+        Eigen::Map<const Eigen::VectorXd> values(column, rowCoordinates.size());
+        colSums(col) = values.sum();
+        colRowMoments(col) = values.dot(rowCoordinates);
+    }
+
+    PhasePlane RegressionPlane::computeAccumulated() {
         Eigen::Vector3d planeCoefficients;
         Eigen::Vector3d vecMean;
+        double nPixels = rowCoordinates.size() * colCoordinates.size();
 
-        phaseCropped = unwrappedPhase.block(rowOffset, colOffset, unwrappedPhase.rows() - 2 * rowOffset, unwrappedPhase.cols() - 2 * colOffset);
-
-        vecMean.x() = meshCol.cwiseProduct(phaseCropped).mean();
-        vecMean.y() = meshRow.cwiseProduct(phaseCropped).mean();
-        vecMean.z() = phaseCropped.mean();
+        vecMean.x() = colCoordinates.dot(colSums) / nPixels;
+        vecMean.y() = colRowMoments.sum() / nPixels;
+        vecMean.z() = colSums.sum() / nPixels;
 
         planeCoefficients = matMean.inverse() * vecMean;
         return PhasePlane(planeCoefficients);
@@ -59,7 +78,9 @@ namespace vernier {
         Eigen::Vector3d planeCoefficients;
         Eigen::Vector3d vecMean;
 
-        phaseCropped = unwrappedPhase.block(rowOffset, colOffset, unwrappedPhase.rows() - 2 * rowOffset, unwrappedPhase.cols() - 2 * colOffset);
+        Eigen::ArrayXXd meshRow = rowCoordinates.replicate(1, colCoordinates.size());
+        Eigen::ArrayXXd meshCol = colCoordinates.transpose().replicate(rowCoordinates.size(), 1);
+        Eigen::ArrayXXd phaseCropped = unwrappedPhase.block(rowOffset, colOffset, unwrappedPhase.rows() - 2 * rowOffset, unwrappedPhase.cols() - 2 * colOffset);
         Eigen::ArrayXXd maskCropped = mask.block(rowOffset, colOffset, unwrappedPhase.rows() - 2 * rowOffset, unwrappedPhase.cols() - 2 * colOffset);
 
         Eigen::ArrayXXd meshColMasked = meshCol.cwiseProduct(maskCropped);
@@ -78,6 +99,62 @@ namespace vernier {
         return PhasePlane(planeCoefficients);
     }
 
+    template<typename _Scalar>
+    PhasePlane RegressionPlane::computeWrapped(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& field, bool shifted) {
+        resize(field.rows(), field.cols());
+        int rows = getNRowsCropped();
+        int cols = getNColsCropped();
+
+        // Coarse slopes from the wrapped phase differences between neighbour pixels
+        std::complex<double> colSum = (field.block(rowOffset, colOffset + 1, rows, cols - 1) * field.block(rowOffset, colOffset, rows, cols - 1).conjugate()).template cast<std::complex<double> >().sum();
+        std::complex<double> rowSum = (field.block(rowOffset + 1, colOffset, rows - 1, cols) * field.block(rowOffset, colOffset, rows - 1, cols).conjugate()).template cast<std::complex<double> >().sum();
+        if (shifted) {
+            colSum = -colSum;
+            rowSum = -rowSum;
+        }
+        double a = std::arg(colSum);
+        double b = std::arg(rowSum);
+
+        // Phase of the field demodulated by the coarse slopes (the demodulation 
+        // is separable along the rows and the columns)
+        for (int row = 0; row < rows; row++) {
+            rowPhasors(row) = std::polar(1.0, -b * rowCoordinates(row));
+            if (shifted && (rowOffset + row) % 2 == 1) {
+                rowPhasors(row) = -rowPhasors(row);
+            }
+        }
+        for (int col = 0; col < cols; col++) {
+            colPhasors(col) = std::polar(1.0, -a * colCoordinates(col));
+            if (shifted && (colOffset + col) % 2 == 1) {
+                colPhasors(col) = -colPhasors(col);
+            }
+        }
+        std::complex<double> sum = 0.0;
+        for (int col = 0; col < cols; col++) {
+            for (int row = 0; row < rows; row++) {
+                sum += colPhasors(col) * rowPhasors(row) * std::complex<double>(field(rowOffset + row, colOffset + col));
+            }
+        }
+
+        // The demodulated phase is nearly constant: once its circular mean is 
+        // removed, it has no wrap left and its regression refines the plane. 
+        // The demodulated field is computed again rather than stored.
+        double c = std::arg(sum);
+        for (int col = 0; col < cols; col++) {
+            for (int row = 0; row < rows; row++) {
+                demodulatedColumn(row) = std::arg(colPhasors(col) * rowPhasors(row) * std::complex<double>(field(rowOffset + row, colOffset + col))) - c;
+            }
+            demodulatedColumn -= 2 * PI * (demodulatedColumn / (2 * PI)).round();
+            accumulateColumn(col, demodulatedColumn.data());
+        }
+        PhasePlane residualPlane = computeAccumulated();
+
+        return PhasePlane(a + residualPlane.getA(), b + residualPlane.getB(), c + residualPlane.getC());
+    }
+
+    template PhasePlane RegressionPlane::computeWrapped(const Eigen::ArrayXXcd&, bool);
+    template PhasePlane RegressionPlane::computeWrapped(const Eigen::ArrayXXcf&, bool);
+
     void RegressionPlane::setCropFactor(double cropFactor) {
         if (cropFactor < 0 || cropFactor >= 1.0) {
             throw Exception("Can't resize a RegressionPlane with cropFactor<0 or cropFactor>=1.0");
@@ -95,19 +172,19 @@ namespace vernier {
     }
 
     int RegressionPlane::getNRows() {
-        return meshRow.rows() + 2 * rowOffset;
+        return rowCoordinates.size() + 2 * rowOffset;
     }
 
     int RegressionPlane::getNCols() {
-        return meshRow.cols() + 2 * colOffset;
+        return colCoordinates.size() + 2 * colOffset;
     }
 
     int RegressionPlane::getNRowsCropped() {
-        return meshRow.rows();
+        return rowCoordinates.size();
     }
 
     int RegressionPlane::getNColsCropped() {
-        return meshRow.cols();
+        return colCoordinates.size();
     }
 
 
@@ -8,23 +8,27 @@
 
 namespace vernier {
 
-    void Spatial::quartersUnwrapPhase(Eigen::ArrayXXd& wrappedPhase) {
-        int sizeX = wrappedPhase.cols();
-        int sizeY = wrappedPhase.rows();
+    /** Unwraps the central row (wrapped in seeds.centralRow) from its center and records the seeds of the columns */
+    static void unwrapCentralRow(UnwrapBuffers& seeds) {
+        std::vector<double>& centralRow = seeds.centralRow;
+        int sizeX = centralRow.size();
         int origineX = (sizeX / 2);
-        int origineY = (sizeY / 2);
- 
-        int phaseIterationX, phaseIterationY;
-        double phaseValuePrevX, phaseValuePrevY, phaseValueNextX, phaseValueNextY;
+
+        int phaseIterationX;
+        double phaseValuePrevX, phaseValueNextX;
         double difference;
 
-        phaseIterationX = 0;
-        phaseValueNextX = wrappedPhase(origineY, origineX);
+        seeds.leftValues.resize(sizeX);
+        seeds.leftIterations.resize(sizeX);
+        seeds.rightValues.resize(sizeX);
+        seeds.rightIterations.resize(sizeX);
 
-        // Loop for the left half of the wrapped phase
+        // Left half of the central row
+        phaseIterationX = 0;
+        phaseValueNextX = centralRow[origineX];
         for (int col = origineX; col > 0; col--) {
             phaseValuePrevX = phaseValueNextX;
-            phaseValueNextX = wrappedPhase(origineY, col - 1);
+            phaseValueNextX = centralRow[col - 1];
 
             difference = phaseValueNextX - phaseValuePrevX;
 
@@ -33,79 +37,21 @@ namespace vernier {
             } else if (difference <= -PI) {
                 phaseIterationX = phaseIterationX + 1;
             }
-            wrappedPhase(origineY, col - 1) = phaseValueNextX + phaseIterationX * 2 * PI;
-
-            // Quarter 3
-            phaseIterationY = phaseIterationX;
-            phaseValueNextY = phaseValueNextX;
-            for (int row = origineY; row > 0; row--) {
-                phaseValuePrevY = phaseValueNextY;
-                phaseValueNextY = wrappedPhase(row - 1, col);
-                difference = phaseValueNextY - phaseValuePrevY;
-
-                if (difference > PI) {
-                    phaseIterationY = phaseIterationY - 1;
-                } else if (difference <= -PI) {
-                    phaseIterationY = phaseIterationY + 1;
-                }
-                wrappedPhase(row - 1, col) = phaseValueNextY + phaseIterationY * 2 * PI;
-            }
-
-            // Quarter 2
-            phaseIterationY = phaseIterationX;
-            phaseValueNextY = phaseValueNextX;
-            for (int row = origineY; row < sizeY - 1; row++) {
-                phaseValuePrevY = phaseValueNextY;
-                phaseValueNextY = wrappedPhase(row + 1, col);
-                difference = phaseValueNextY - phaseValuePrevY;
-
-                if (difference > PI) {
-                    phaseIterationY = phaseIterationY - 1;
-                } else if (difference <= -PI) {
-                    phaseIterationY = phaseIterationY + 1;
-                }
-                wrappedPhase(row + 1, col) = phaseValueNextY + phaseIterationY * 2 * PI;
-            }
-        }
-        // first row unwrapping
-        // Quarter 3 first row
-        phaseIterationY = phaseIterationX;
-        phaseValueNextY = phaseValueNextX;
-        for (int row = origineY; row > 0; row--) {
-            phaseValuePrevY = phaseValueNextY;
-            phaseValueNextY = wrappedPhase(row - 1, 0);
-            difference = phaseValueNextY - phaseValuePrevY;
+            centralRow[col - 1] = phaseValueNextX + phaseIterationX * 2 * PI;
 
-            if (difference > PI) {
-                phaseIterationY = phaseIterationY - 1;
-            } else if (difference <= -PI) {
-                phaseIterationY = phaseIterationY + 1;
-            }
-            wrappedPhase(row - 1, 0) = phaseValueNextY + phaseIterationY * 2 * PI;
+            seeds.leftValues[col] = phaseValueNextX;
+            seeds.leftIterations[col] = phaseIterationX;
         }
+        // first column
+        seeds.leftValues[0] = phaseValueNextX;
+        seeds.leftIterations[0] = phaseIterationX;
 
-        // Quarter 2 first row
-        phaseIterationY = phaseIterationX;
-        phaseValueNextY = phaseValueNextX;
-        for (int row = origineY; row < sizeY - 1; row++) {
-            phaseValuePrevY = phaseValueNextY;
-            phaseValueNextY = wrappedPhase(row + 1, 0);
-            difference = phaseValueNextY - phaseValuePrevY;
-
-            if (difference > PI) {
-                phaseIterationY = phaseIterationY - 1;
-            } else if (difference <= -PI) {
-                phaseIterationY = phaseIterationY + 1;
-            }
-            wrappedPhase(row + 1, 0) = phaseValueNextY + phaseIterationY * 2 * PI;
-        }
-
-        // Loop for the right half of the wrapped phase
+        // Right half of the central row
         phaseIterationX = 0;
-        phaseValueNextX = wrappedPhase(origineY, origineX);
+        phaseValueNextX = centralRow[origineX];
         for (int col = origineX; col < sizeX - 1; col++) {
             phaseValuePrevX = phaseValueNextX;
-            phaseValueNextX = wrappedPhase(origineY, col + 1);
+            phaseValueNextX = centralRow[col + 1];
 
             difference = phaseValueNextX - phaseValuePrevX;
 
@@ -114,47 +60,28 @@ namespace vernier {
             } else if (difference <= -PI) {
                 phaseIterationX = phaseIterationX + 1;
             }
-            wrappedPhase(origineY, col + 1) = phaseValueNextX + phaseIterationX * 2 * PI;
-
-            // Quarter 4
-            phaseIterationY = phaseIterationX;
-            phaseValueNextY = phaseValueNextX;
-            for (int row = origineY; row > 0; row--) {
-                phaseValuePrevY = phaseValueNextY;
-                phaseValueNextY = wrappedPhase(row - 1, col);
-                difference = phaseValueNextY - phaseValuePrevY;
-
-                if (difference > PI) {
-                    phaseIterationY = phaseIterationY - 1;
-                } else if (difference <= -PI) {
-                    phaseIterationY = phaseIterationY + 1;
-                }
-                wrappedPhase(row - 1, col) = phaseValueNextY + phaseIterationY * 2 * PI;
-            }
+            centralRow[col + 1] = phaseValueNextX + phaseIterationX * 2 * PI;
 
-            // Quarter 1
-            phaseIterationY = phaseIterationX;
-            phaseValueNextY = phaseValueNextX;
-            for (int row = origineY; row < sizeY - 1; row++) {
-                phaseValuePrevY = phaseValueNextY;
-                phaseValueNextY = wrappedPhase(row + 1, col);
-                difference = phaseValueNextY - phaseValuePrevY;
-
-                if (difference > PI) {
-                    phaseIterationY = phaseIterationY - 1;
-                } else if (difference <= -PI) {
-                    phaseIterationY = phaseIterationY + 1;
-                }
-                wrappedPhase(row + 1, col) = phaseValueNextY + phaseIterationY * 2 * PI;
-            }
+            seeds.rightValues[col] = phaseValueNextX;
+            seeds.rightIterations[col] = phaseIterationX;
         }
-        // last row unwrapping
-        // Quarter 4 last row
-        phaseIterationY = phaseIterationX;
-        phaseValueNextY = phaseValueNextX;
+        // last column
+        seeds.rightValues[sizeX - 1] = phaseValueNextX;
+        seeds.rightIterations[sizeX - 1] = phaseIterationX;
+    }
+
+    /** Unwraps a column (contiguous values) above and below the central row from a seed */
+    static void unwrapColumn(double* column, int sizeY, int origineY, double seedValue, int seedIteration) {
+        int phaseIterationY;
+        double phaseValuePrevY, phaseValueNextY;
+        double difference;
+
+        // Quarters 2 and 3
+        phaseIterationY = seedIteration;
+        phaseValueNextY = seedValue;
         for (int row = origineY; row > 0; row--) {
             phaseValuePrevY = phaseValueNextY;
-            phaseValueNextY = wrappedPhase(row - 1, sizeX - 1);
+            phaseValueNextY = column[row - 1];
             difference = phaseValueNextY - phaseValuePrevY;
 
             if (difference > PI) {
@@ -162,15 +89,15 @@ namespace vernier {
             } else if (difference <= -PI) {
                 phaseIterationY = phaseIterationY + 1;
             }
-            wrappedPhase(row - 1, sizeX - 1) = phaseValueNextY + phaseIterationY * 2 * PI;
+            column[row - 1] = phaseValueNextY + phaseIterationY * 2 * PI;
         }
 
-        // Quarter 1 last row
-        phaseIterationY = phaseIterationX;
-        phaseValueNextY = phaseValueNextX;
+        // Quarters 1 and 4
+        phaseIterationY = seedIteration;
+        phaseValueNextY = seedValue;
         for (int row = origineY; row < sizeY - 1; row++) {
             phaseValuePrevY = phaseValueNextY;
-            phaseValueNextY = wrappedPhase(row + 1, sizeX - 1);
+            phaseValueNextY = column[row + 1];
             difference = phaseValueNextY - phaseValuePrevY;
 
             if (difference > PI) {
@@ -178,7 +105,109 @@ namespace vernier {
             } else if (difference <= -PI) {
                 phaseIterationY = phaseIterationY + 1;
             }
-            wrappedPhase(row + 1, sizeX - 1) = phaseValueNextY + phaseIterationY * 2 * PI;
+            column[row + 1] = phaseValueNextY + phaseIterationY * 2 * PI;
+        }
+    }
+
+    /** Unwraps a column from its seeds. The central column belongs to both 
+     * halves: it is unwrapped from its left seed then from its right seed. */
+    static void unwrapColumn(double* column, int sizeY, int origineY, const UnwrapBuffers& seeds, int col) {
+        int origineX = (seeds.centralRow.size() / 2);
+        if (col <= origineX) {
+            unwrapColumn(column, sizeY, origineY, seeds.leftValues[col], seeds.leftIterations[col]);
+        }
+        if (col >= origineX) {
+            unwrapColumn(column, sizeY, origineY, seeds.rightValues[col], seeds.rightIterations[col]);
+        }
+    }
+
+    /** Unwraps a strip of contiguous columns of a phase map */
+    static void unwrapColumns(Eigen::ArrayXXd& wrappedPhase, const UnwrapBuffers& seeds, int firstCol, int lastCol) {
+        for (int col = firstCol; col < lastCol; col++) {
+            unwrapColumn(&wrappedPhase(0, col), wrappedPhase.rows(), wrappedPhase.rows() / 2, seeds, col);
+        }
+    }
+
+    /** Unwraps a strip of contiguous cropped columns of the phase of a field 
+     * and gives them to the regression */
+    template<typename _Scalar>
+    static void unwrapFieldColumns(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& field, bool shifted, const UnwrapBuffers& seeds, Eigen::VectorXd& column, RegressionPlane& regressionPlane, int firstCol, int lastCol) {
+        int rowOffset = regressionPlane.getRowOffset();
+        int colOffset = regressionPlane.getColOffset();
+        int rows = regressionPlane.getNRowsCropped();
+        int origineY = field.rows() / 2 - rowOffset;
+        column.resize(rows);
+        for (int col = firstCol; col < lastCol; col++) {
+            int fieldCol = colOffset + col;
+            for (int row = 0; row < rows; row++) {
+                int fieldRow = rowOffset + row;
+                column(row) = std::arg((shifted && ((fieldRow + fieldCol) & 1)) ? -field(fieldRow, fieldCol) : field(fieldRow, fieldCol));
+            }
+            column(origineY) = seeds.centralRow[fieldCol];
+            unwrapColumn(column.data(), rows, origineY, seeds, fieldCol);
+            regressionPlane.accumulateColumn(col, column.data());
+        }
+    }
+
+    /** Runs a strip function over the columns [0, nCols) split in one strip 
+     * of contiguous columns per thread of the pool (contiguous memory for the 
+     * column-major arrays) */
+    template<typename _Function>
+    static void runByStrips(int nCols, ThreadPool& threadPool, const _Function& function) {
+        threadPool.run([&](int part, int nParts) {
+            function(nCols * part / nParts, nCols * (part + 1) / nParts);
+        });
+    }
+
+    size_t UnwrapBuffers::memoryFootprint() {
+        size_t size = sizeof (double) * (centralRow.capacity() + leftValues.capacity() + rightValues.capacity())
+                + sizeof (int) * (leftIterations.capacity() + rightIterations.capacity());
+        for (int i = 0; i < (int) columns.size(); i++) {
+            size += sizeof (double) * columns[i].size();
         }
+        return size;
+    }
+
+    void Spatial::quartersUnwrapPhase(Eigen::ArrayXXd& wrappedPhase) {
+        UnwrapBuffers buffers;
+        ThreadPool threadPool;
+        quartersUnwrapPhase(wrappedPhase, buffers, threadPool);
     }
-}
\ No newline at end of file
+
+    void Spatial::quartersUnwrapPhase(Eigen::ArrayXXd& wrappedPhase, UnwrapBuffers& buffers, ThreadPool& threadPool) {
+        int origineY = (wrappedPhase.rows() / 2);
+
+        buffers.centralRow.resize(wrappedPhase.cols());
+        Eigen::Map<Eigen::RowVectorXd> centralRow(buffers.centralRow.data(), wrappedPhase.cols());
+        centralRow = wrappedPhase.row(origineY);
+        unwrapCentralRow(buffers);
+        wrappedPhase.row(origineY) = centralRow;
+
+        // The columns only depend on their seeds
+        runByStrips(wrappedPhase.cols(), threadPool, [&](int firstCol, int lastCol) {
+            unwrapColumns(wrappedPhase, buffers, firstCol, lastCol);
+        });
+    }
+
+    template<typename _Scalar>
+    void Spatial::quartersUnwrapPhase(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& field, bool shifted, RegressionPlane& regressionPlane, UnwrapBuffers& buffers, ThreadPool& threadPool) {
+        regressionPlane.resize(field.rows(), field.cols());
+        int origineY = (field.rows() / 2);
+
+        buffers.centralRow.resize(field.cols());
+        for (int col = 0; col < field.cols(); col++) {
+            buffers.centralRow[col] = std::arg((shifted && ((origineY + col) & 1)) ? -field(origineY, col) : field(origineY, col));
+        }
+        unwrapCentralRow(buffers);
+
+        // Each thread unwraps its columns in its own buffer
+        int nCols = regressionPlane.getNColsCropped();
+        buffers.columns.resize(threadPool.getNumberOfThreads());
+        threadPool.run([&](int part, int nParts) {
+            unwrapFieldColumns(field, shifted, buffers, buffers.columns[part], regressionPlane, nCols * part / nParts, nCols * (part + 1) / nParts);
+        });
+    }
+
+    template void Spatial::quartersUnwrapPhase(const Eigen::ArrayXXcd&, bool, RegressionPlane&, UnwrapBuffers&, ThreadPool&);
+    template void Spatial::quartersUnwrapPhase(const Eigen::ArrayXXcf&, bool, RegressionPlane&, UnwrapBuffers&, ThreadPool&);
+}
@@ -9,7 +9,8 @@
 
 namespace vernier {
 
-    void Spectrum::shift(Eigen::ArrayXXcd& source, Eigen::ArrayXXcd& dest) {
+    template<typename _Scalar>
+    void Spectrum::shift(Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& dest) {
         ASSERT(source.rows() > 0 && source.cols() > 0);
         dest.resize(source.rows(), source.cols());
         int nTop = source.rows() / 2;
@@ -22,15 +23,26 @@ namespace vernier {
         dest.block(0, nLeft, nTop, nRight) = source.block(nBottom, 0, nTop, nRight);
     }
 
-    void Spectrum::mainPeakCircle(Eigen::ArrayXXcd& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2, double approxPixelPeriod) {
+    template<typename _Scalar>
+    void Spectrum::shiftHermitian(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSource, int nRows, Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& dest) {
+        ASSERT(halfSource.rows() == nRows / 2 + 1 && halfSource.cols() > 0);
+        dest.resize(nRows, halfSource.cols());
+        for (int col = 0; col < dest.cols(); col++) {
+            for (int row = 0; row < dest.rows(); row++) {
+                dest(row, col) = hermitianValue(halfSource, nRows, row, col);
+            }
+        }
+    }
+
+    template<typename _Scalar>
+    void Spectrum::mainPeakCircle(Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2, double approxPixelPeriod) {
         double maxValue = 0;
-        Eigen::ArrayXXcd sourceSave = source;
 
         int offset = (((double) source.rows() / (double) approxPixelPeriod)) * (sqrt(2) / 2);
 
         for (int col = source.cols() / 2 + offset; col < source.cols(); col++) {
             for (int row = source.rows() / 2 - offset; row < source.rows() / 2 + offset; row++) {
-                std::complex<double> complexValue = source(row, col);
+                std::complex<_Scalar> complexValue = source(row, col);
 
 
                 double frequenceColApprox = ((double) col - (double) source.cols() / 2.0) / ((double) source.cols() / (double) approxPixelPeriod);
@@ -78,7 +90,7 @@ namespace vernier {
 
         for (int col = (int) mainPeak2supposed.x() - sizeSearchP2; col < (int) mainPeak2supposed.x() + sizeSearchP2; col++) {
             for (int row = (int) mainPeak2supposed.y() - sizeSearchP2; row < (int) mainPeak2supposed.y() + sizeSearchP2; row++) {
-                std::complex<double> complexValue2 = source(row, col);
+                std::complex<_Scalar> complexValue2 = source(row, col);
                 double norm2 = complexValue2.real() * complexValue2.real() + complexValue2.imag() * complexValue2.imag();
                 if (norm2 > maxValue) {
                     maxValue = norm2;
@@ -88,12 +100,10 @@ namespace vernier {
                 }
             }
         }
-
-        source = sourceSave;
-
     }
 
-    void Spectrum::mainPeakQuarter(Eigen::ArrayXXcd& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
+    template<typename _Scalar>
+    void Spectrum::mainPeakQuarter(Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
         int offsetMin = source.rows() / 100.0;
         source.block(source.rows() / 2 - offsetMin / 2, source.cols() / 2 - offsetMin / 2, offsetMin, offsetMin) = 0;
 
@@ -101,7 +111,7 @@ namespace vernier {
 
         for (int col = source.cols() / 2 + 10; col < source.cols(); col++) {
             for (int row = source.rows() / 2 - 2; row < source.rows(); row++) {
-                std::complex<double> complexValue = source(row, col);
+                std::complex<_Scalar> complexValue = source(row, col);
                 double norm = complexValue.real() * complexValue.real() + complexValue.imag() * complexValue.imag();
                 if (norm > maxValue) {
                     maxValue = norm;
@@ -140,7 +150,7 @@ namespace vernier {
                 double ryMax = r * sin(peak2Angle + thetaMax) + source.cols() / 2;
 
                 if ((row > rxMin - source.rows() / 2 && row < rxMax - source.rows() / 2 && col < ryMax - source.cols() / 2) || (row > rxMax - source.rows() / 2 && col > ryMin - source.cols() / 2 && col < ryMax - source.cols() / 2)) {
-                    std::complex<double> complexValue2 = source(source.rows() / 2 + row, source.cols() / 2 + col);
+                    std::complex<_Scalar> complexValue2 = source(source.rows() / 2 + row, source.cols() / 2 + col);
                     double norm2 = complexValue2.real() * complexValue2.real() + complexValue2.imag() * complexValue2.imag();
                     if (norm2 > maxValue) {
                         maxValue = norm2;
@@ -154,151 +164,429 @@ namespace vernier {
         }
     }
 
-    void Spectrum::mainPeakPerimeter(Eigen::ArrayXXcd& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
-        Eigen::ArrayXXcd sourceSave = source;
-        int offsetMin = source.rows() / 100.0;
-        source.block(source.rows() / 2 - offsetMin / 2, source.cols() / 2 - offsetMin / 2, offsetMin, offsetMin) = 0;
+    // Candidate peak of mainPeakPerimeter() and mainPeak4Search()
+    struct PeakCandidate {
+        int row, col;
+        double power;
+        double angle; // angle of the peak around the center of the spectrum
+        double sum; // sum of the magnitudes of the 2x2 block before the peak (mainPeak4Search)
+    };
+
+    // Returns true if the peak is found before the candidate in the search 
+    // (larger power, or same power and first in the column-major order)
+    static bool largerPeak(const PeakCandidate& peak, const PeakCandidate& candidate) {
+        return peak.power > candidate.power || (peak.power == candidate.power && (peak.col < candidate.col || (peak.col == candidate.col && peak.row < candidate.row)));
+    }
 
-        Eigen::ArrayXXd mainPeakList(0, 3);
+    // Returns true if (row, col) is zeroed around a peak found by the former 
+    // iterative search (8x8 block, or only the peak on the borders)
+    static bool inPeakBlock(int row, int col, const PeakCandidate& peak, int nRows, int nCols) {
+        if (peak.row - 4 > 0 && peak.col - 4 > 0 && peak.row + 4 < nRows && peak.col + 4 < nCols) {
+            return row >= peak.row - 4 && row < peak.row + 4 && col >= peak.col - 4 && col < peak.col + 4;
+        }
+        return row == peak.row && col == peak.col;
+    }
 
-        int count = 0;
+    // Selects the nPeaks peaks of the former iterative search, which took the 
+    // maximum of the power of the spectrum and zeroed its block, nPeaks times, 
+    // the center square of size offsetMin being zeroed first. Its k-th peak is 
+    // the largest coefficient outside the center and the blocks of the k - 1 
+    // first peaks, so the peaks are found by going through the coefficients in 
+    // decreasing order and skipping the ones in the blocks of the larger peaks.
+    // Since a block holds at most 64 coefficients, the nPeaks + 64 * (nPeaks - 1)
+    // largest coefficients are enough: they are kept in a min-heap during a 
+    // single scan. The missing peaks of a spectrum with too few nonzero 
+    // coefficients are set at the center with a zero power.
+    template<typename _Scalar>
+    static void largestPeaks(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, int offsetMin, int nPeaks, std::vector<PeakCandidate>& peaks) {
+        int nRows = source.rows();
+        int nCols = source.cols();
+        int centerRow = nRows / 2 - offsetMin / 2;
+        int centerCol = nCols / 2 - offsetMin / 2;
+
+        // Min-heap of the largest coefficients (the smallest one on top)
+        int capacity = nPeaks + 64 * (nPeaks - 1);
+        std::vector<PeakCandidate> heap;
+        heap.reserve(capacity);
+        for (int col = 0; col < nCols; col++) {
+            for (int row = 0; row < nRows; row++) {
+                if (row >= centerRow && row < centerRow + offsetMin && col >= centerCol && col < centerCol + offsetMin) {
+                    continue;
+                }
+                std::complex<_Scalar> complexValue = source(row, col);
+                double value = complexValue.real() * complexValue.real() + complexValue.imag() * complexValue.imag();
+                if (value <= 0.0) {
+                    continue;
+                }
+                PeakCandidate candidate = {row, col, value, 0.0, 0.0};
+                if ((int) heap.size() < capacity) {
+                    heap.push_back(candidate);
+                    std::push_heap(heap.begin(), heap.end(), largerPeak);
+                } else if (largerPeak(candidate, heap.front())) {
+                    std::pop_heap(heap.begin(), heap.end(), largerPeak);
+                    heap.back() = candidate;
+                    std::push_heap(heap.begin(), heap.end(), largerPeak);
+                }
+            }
+        }
+        std::sort(heap.begin(), heap.end(), largerPeak);
 
-        while (mainPeakList.rows() < 8) {
+        peaks.clear();
+        for (const PeakCandidate& candidate : heap) {
+            bool excluded = false;
+            for (const PeakCandidate& peak : peaks) {
+                excluded = excluded || inPeakBlock(candidate.row, candidate.col, peak, nRows, nCols);
+            }
+            if (!excluded) {
+                peaks.push_back(candidate);
+                if ((int) peaks.size() == nPeaks) {
+                    break;
+                }
+            }
+        }
+        PeakCandidate center = {nRows / 2, nCols / 2, 0.0, 0.0, 0.0};
+        peaks.resize(nPeaks, center);
+        for (PeakCandidate& peak : peaks) {
+            peak.angle = atan2(peak.row - nRows / 2, peak.col - nCols / 2);
+        }
+    }
 
-            double maxValue = 0;
-            mainPeakList.conservativeResize(mainPeakList.rows() + 1, 3);
+    static bool smallerAngle(const PeakCandidate& peak1, const PeakCandidate& peak2) {
+        return peak1.angle < peak2.angle;
+    }
 
-            for (int col = 0; col < source.cols(); col++) {
-                for (int row = 0; row < source.rows(); row++) {
-                    std::complex<double> complexValue = source(row, col);
-                    double norm = complexValue.real() * complexValue.real() + complexValue.imag() * complexValue.imag();
-                    if (norm > maxValue) {
-                        maxValue = norm;
-                        mainPeakList(mainPeakList.rows() - 1, 0) = col;
-                        mainPeakList(mainPeakList.rows() - 1, 1) = row;
-                        mainPeakList(mainPeakList.rows() - 1, 2) = atan2(row - source.rows() / 2, col - source.cols() / 2);
+    template<typename _Scalar>
+    void Spectrum::mainPeakPerimeter(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
+        int offsetMin = source.rows() / 100.0;
+        std::vector<PeakCandidate> peaks;
+        largestPeaks(source, offsetMin, 8, peaks);
+        std::sort(peaks.begin(), peaks.end(), smallerAngle);
 
-                    }
+        double dist1 = 0;
+        double dist2 = 0;
+        for (int i = 0; i < (int) peaks.size() / 2 - 1; i++) {
+            dist1 += getDistancePoints(peaks[2 * i].col, peaks[2 * i].row, peaks[2 * (i + 1)].col, peaks[2 * (i + 1)].row);
+            dist2 += getDistancePoints(peaks[2 * i + 1].col, peaks[2 * i + 1].row, peaks[2 * (i + 1) + 1].col, peaks[2 * (i + 1) + 1].row);
+        }
 
-                }
+        int first = (dist1 < dist2) ? 4 : 3;
+        mainPeak1.x() = peaks[first].col;
+        mainPeak1.y() = peaks[first].row;
+        mainPeak2.x() = peaks[first + 2].col;
+        mainPeak2.y() = peaks[first + 2].row;
+    }
 
+    // The magnitude map of the half plane search holds the rows nRows / 2 - 1 
+    // to nRows - 1 of the shifted spectrum (the searched rows and their neighbours)
+
+    // Sets to zero the intersection of a square of the shifted spectrum with the magnitude map
+    template<typename _Scalar>
+    static void zeroSquare(Eigen::Array<_Scalar, Eigen::Dynamic, Eigen::Dynamic>& magnitude, int nRows, int squareRow, int squareCol, int size) {
+        int rowOffset = nRows / 2 - 1;
+        int rowMin = std::max(0, squareRow - rowOffset);
+        int rowMax = std::min((int) magnitude.rows(), squareRow + size - rowOffset);
+        int colMin = std::max(0, squareCol);
+        int colMax = std::min((int) magnitude.cols(), squareCol + size);
+        if (rowMin < rowMax && colMin < colMax) {
+            magnitude.block(rowMin, colMin, rowMax - rowMin, colMax - colMin).setZero();
+        }
+    }
+
+    // Searches the maximum of the sums of the magnitudes of each coefficient 
+    // and its four neighbours over the searched columns of the magnitude map 
+    // (the first maximum in the column-major order is kept). The sums of a 
+    // column are vectorized.
+    template<typename _Scalar>
+    static bool searchCrossSum(const Eigen::Array<_Scalar, Eigen::Dynamic, Eigen::Dynamic>& magnitude, int nRows, double minValue, Eigen::Vector3d& peak) {
+        int nCols = magnitude.cols();
+        int n = magnitude.rows() - 2;
+        double maxValue = minValue;
+        int maxRow = -1;
+        int maxCol = -1;
+        for (int col = 1; col < nCols - 1; col++) {
+            Eigen::Index row;
+            double value = (magnitude.col(col).segment(1, n) + magnitude.col(col).segment(0, n) + magnitude.col(col - 1).segment(1, n)
+                    + magnitude.col(col).segment(2, n) + magnitude.col(col + 1).segment(1, n)).maxCoeff(&row);
+            if (value > maxValue) {
+                maxValue = value;
+                maxRow = row + 1;
+                maxCol = col;
             }
+        }
+        if (maxCol < 0) {
+            return false;
+        }
+        peak.x() = maxCol;
+        peak.y() = maxRow + nRows / 2 - 1;
+        peak.z() = maxValue / nCols / nRows / 5; // MAGIC NUMBER
+        return true;
+    }
 
-            if (mainPeakList(mainPeakList.rows() - 1, 1) - 4 > 0 && mainPeakList(mainPeakList.rows() - 1, 0) - 4 > 0 && mainPeakList(mainPeakList.rows() - 1, 1) + 4 < source.rows() && mainPeakList(mainPeakList.rows() - 1, 0) + 4 < source.cols()) {
-                source.block(mainPeakList(mainPeakList.rows() - 1, 1) - 4, mainPeakList(mainPeakList.rows() - 1, 0) - 4, 8, 8) = 0;
+    // Searches the two peaks on the magnitude map. The neighbourhoods of the 
+    // center and of the first peak are excluded by zeroing them in the map
+    template<typename _Scalar>
+    static void mainPeaksOfMagnitude(Eigen::Array<_Scalar, Eigen::Dynamic, Eigen::Dynamic>& magnitude, int nRows, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
+        int nCols = magnitude.cols();
+        int offsetMin = nRows / 100.0; // MAGIC NUMBER
+        if (offsetMin < 20)
+            offsetMin = 20;
+        zeroSquare(magnitude, nRows, nRows / 2 - offsetMin / 2, nCols / 2 - offsetMin / 2, offsetMin);
 
-            } else {
-                source(mainPeakList(mainPeakList.rows() - 1, 1), mainPeakList(mainPeakList.rows() - 1, 0)) = 0;
+        searchCrossSum(magnitude, nRows, -1.0, mainPeak1);
 
-            }
+        zeroSquare(magnitude, nRows, mainPeak1.y() - 4, mainPeak1.x() - 4, 8);
+        zeroSquare(magnitude, nRows, (nRows - mainPeak1.y()) - 4, (nCols - mainPeak1.x()) - 4, 8);
 
-            count++;
+        searchCrossSum(magnitude, nRows, 0.0, mainPeak2);
 
+        if (mainPeak1.x() < mainPeak2.x()) {
+            std::swap(mainPeak1, mainPeak2);
         }
+    }
 
+    template<typename _Scalar>
+    void Spectrum::mainPeakHalfPlane(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Array<_Scalar, Eigen::Dynamic, Eigen::Dynamic>& magnitude, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
+        int nRows = source.rows();
+        magnitude = source.block(nRows / 2 - 1, 0, nRows - nRows / 2 + 1, source.cols()).abs();
+        mainPeaksOfMagnitude(magnitude, nRows, mainPeak1, mainPeak2);
+    }
+
+    template<typename _Scalar>
+    void Spectrum::mainPeakHalfPlane(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
+        Eigen::Array<_Scalar, Eigen::Dynamic, Eigen::Dynamic> magnitude;
+        mainPeakHalfPlane(source, magnitude, mainPeak1, mainPeak2);
+    }
+
+    template<typename _Scalar>
+    void Spectrum::mainPeakHalfPlane(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSource, int nRows, Eigen::Array<_Scalar, Eigen::Dynamic, Eigen::Dynamic>& magnitude, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
+        int nCols = halfSource.cols();
+        int nHalfRows = nRows - nRows / 2;
+        int nLeft = nCols / 2;
+        int nRight = nCols - nLeft;
+        magnitude.resize(nHalfRows + 1, nCols);
+
+        // The first row is mirrored from the half spectrum, the others are 
+        // its first rows with the columns shifted
+        for (int col = 0; col < nCols; col++) {
+            magnitude(0, col) = std::abs(hermitianValue(halfSource, nRows, nRows / 2 - 1, col));
+        }
+        magnitude.block(1, 0, nHalfRows, nLeft) = halfSource.block(0, nRight, nHalfRows, nLeft).abs();
+        magnitude.block(1, nLeft, nHalfRows, nRight) = halfSource.block(0, 0, nHalfRows, nRight).abs();
+
+        mainPeaksOfMagnitude(magnitude, nRows, mainPeak1, mainPeak2);
+    }
 
-        Eigen::ArrayXXd mainPeakListOrdered(mainPeakList.rows(), 3);
-        for (int k = 0; k < mainPeakList.rows(); k++) {
-            double minAngle = 10e10;
-            int iterator = 0;
-            for (int i = 0; i < mainPeakList.rows(); i++) {
-                if (mainPeakList(i, 2) < minAngle) {
-                    minAngle = mainPeakList(i, 2);
-                    iterator = i;
+    template<typename _Scalar>
+    void Spectrum::mainPeakHalfPlane(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSource, int nRows, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
+        Eigen::Array<_Scalar, Eigen::Dynamic, Eigen::Dynamic> magnitude;
+        mainPeakHalfPlane(halfSource, nRows, magnitude, mainPeak1, mainPeak2);
+    }
 
+    void Spectrum::annulusIndices(int nRows, int nCols, double minPixelPeriod, double maxPixelPeriod, std::vector<int>& indices) {
+        if (minPixelPeriod <= 0.0 || maxPixelPeriod < minPixelPeriod) {
+            throw Exception("The pixel period bounds of the annulus must be positive and sorted.");
+        }
+        // The period of the coefficient (row, col) is 1 / sqrt((dRow / nRows)^2 + (dCol / nCols)^2)
+        double minFrequency2 = 1.0 / (maxPixelPeriod * maxPixelPeriod);
+        double maxFrequency2 = 1.0 / (minPixelPeriod * minPixelPeriod);
+        indices.clear();
+        for (int col = 1; col < nCols - 1; col++) {
+            double frequencyCol = (double) (col - nCols / 2) / nCols;
+            for (int row = nRows / 2; row < nRows - 1; row++) {
+                double frequencyRow = (double) (row - nRows / 2) / nRows;
+                double frequency2 = frequencyRow * frequencyRow + frequencyCol * frequencyCol;
+                if (frequency2 >= minFrequency2 && frequency2 <= maxFrequency2) {
+                    indices.push_back(col * nRows + row);
                 }
+            }
+        }
+    }
+
+    // Same criterion and exclusions as mainPeakHalfPlane(), evaluated only on 
+    // the coefficients of the annulus. The excluded neighbours are skipped 
+    // (the annulus is a small part of the spectrum, no magnitude map is needed)
+    static bool inSquare(int row, int col, int squareRow, int squareCol, int size) {
+        return row >= squareRow && row < squareRow + size && col >= squareCol && col < squareCol + size;
+    }
+
+    template<typename _Coefficient>
+    static void mainPeaksOfAnnulus(int nRows, int nCols, const std::vector<int>& annulus, _Coefficient coefficient, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
+        int offsetMin = nRows / 100.0; // MAGIC NUMBER
+        if (offsetMin < 20)
+            offsetMin = 20;
 
+        for (int peak = 0; peak < 2; peak++) {
+            Eigen::Vector3d& mainPeak = (peak == 0) ? mainPeak1 : mainPeak2;
+            double maxValue = (peak == 0) ? -1.0 : 0.0;
+            mainPeak.z() = 0.0; // not found if the annulus is empty
+            for (int index : annulus) {
+                int row = index % nRows;
+                int col = index / nRows;
+                int neighbourRows[5] = {row, row - 1, row, row + 1, row};
+                int neighbourCols[5] = {col, col, col - 1, col, col + 1};
+                double norm = 0.0;
+                for (int i = 0; i < 5; i++) {
+                    int r = neighbourRows[i];
+                    int c = neighbourCols[i];
+                    if (inSquare(r, c, nRows / 2 - offsetMin / 2, nCols / 2 - offsetMin / 2, offsetMin)) {
+                        continue;
+                    }
+                    if (peak == 1 && (inSquare(r, c, mainPeak1.y() - 4, mainPeak1.x() - 4, 8) || inSquare(r, c, (nRows - mainPeak1.y()) - 4, (nCols - mainPeak1.x()) - 4, 8))) {
+                        continue;
+                    }
+                    norm += std::abs(coefficient(r, c));
+                }
+                if (norm > maxValue) {
+                    maxValue = norm;
+                    mainPeak.x() = col;
+                    mainPeak.y() = row;
+                    mainPeak.z() = norm / nCols / nRows / 5; // MAGIC NUMBER
+                }
             }
-            mainPeakListOrdered.block(k, 0, 1, 3) = mainPeakList.block(iterator, 0, 1, 3);
-            mainPeakList(iterator, 2) = 10e6;
+        }
 
+        if (mainPeak1.x() < mainPeak2.x()) {
+            std::swap(mainPeak1, mainPeak2);
         }
+    }
 
-        double dist1 = 0;
-        double dist2 = 0;
-        for (int i = 0; i < mainPeakListOrdered.rows() / 2 - 1; i++) {
-            dist1 += getDistancePoints(mainPeakListOrdered(2 * i, 0), mainPeakListOrdered(2 * i, 1), mainPeakListOrdered(2 * (i + 1), 0), mainPeakListOrdered(2 * (i + 1), 1));
-            dist2 += getDistancePoints(mainPeakListOrdered(2 * i + 1, 0), mainPeakListOrdered(2 * i + 1, 1), mainPeakListOrdered(2 * (i + 1) + 1, 0), mainPeakListOrdered(2 * (i + 1) + 1, 1));
+    template<typename _Scalar>
+    void Spectrum::mainPeakAnnulus(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, const std::vector<int>& annulus, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
+        mainPeaksOfAnnulus(source.rows(), source.cols(), annulus, [&source](int row, int col) {
+            return source(row, col);
+        }, mainPeak1, mainPeak2);
+    }
+
+    template<typename _Scalar>
+    void Spectrum::mainPeakAnnulus(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSource, int nRows, const std::vector<int>& annulus, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
+        mainPeaksOfAnnulus(nRows, halfSource.cols(), annulus, [&halfSource, nRows](int row, int col) {
+            return hermitianValue(halfSource, nRows, row, col);
+        }, mainPeak1, mainPeak2);
+    }
 
+    // Offset of a peak from its bin given by the Jacobsen estimator on three 
+    // neighbour coefficients, with the bias correction of Candan for 
+    // unwindowed signals of n samples
+    static double interpolatedOffset(std::complex<double> previous, std::complex<double> peak, std::complex<double> next, int n) {
+        std::complex<double> denominator = 2.0 * peak - previous - next;
+        if (std::abs(denominator) == 0.0) {
+            return 0.0;
         }
+        double offset = std::real((previous - next) / denominator) * tan(PI / n) / (PI / n);
+        return std::max(-0.5, std::min(0.5, offset));
+    }
 
-        if (dist1 < dist2) {
-            mainPeak1.x() = mainPeakListOrdered(4, 0);
-            mainPeak1.y() = mainPeakListOrdered(4, 1);
-            mainPeak2.x() = mainPeakListOrdered(6, 0);
-            mainPeak2.y() = mainPeakListOrdered(6, 1);
-
-        } else {
-            mainPeak1.x() = mainPeakListOrdered(3, 0);
-            mainPeak1.y() = mainPeakListOrdered(3, 1);
-            mainPeak2.x() = mainPeakListOrdered(5, 0);
-            mainPeak2.y() = mainPeakListOrdered(5, 1);
+    template<typename _Coefficient>
+    static void refinePeakOf(int nRows, int nCols, _Coefficient coefficient, Eigen::Vector3d& peak) {
+        int row = peak.y();
+        int col = peak.x();
+        std::complex<double> center = coefficient(row, col);
+        if (col > 0 && col < nCols - 1) {
+            peak.x() = col + interpolatedOffset(coefficient(row, col - 1), center, coefficient(row, col + 1), nCols);
+        }
+        if (row > 0 && row < nRows - 1) {
+            peak.y() = row + interpolatedOffset(coefficient(row - 1, col), center, coefficient(row + 1, col), nRows);
         }
+    }
 
-        source = sourceSave;
+    template<typename _Scalar>
+    void Spectrum::refinePeak(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Vector3d& peak) {
+        refinePeakOf(source.rows(), source.cols(), [&source](int row, int col) {
+            return (std::complex<double>) source(row, col);
+        }, peak);
+    }
 
+    template<typename _Scalar>
+    void Spectrum::refinePeak(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSource, int nRows, Eigen::Vector3d& peak) {
+        refinePeakOf(nRows, halfSource.cols(), [&halfSource, nRows](int row, int col) {
+            return (std::complex<double>) hermitianValue(halfSource, nRows, row, col);
+        }, peak);
     }
 
-    void Spectrum::mainPeakHalfPlane(Eigen::ArrayXXcd& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
-        int offsetMin = source.rows() / 100.0; // MAGIC NUMBER
-        if (offsetMin < 20) 
-            offsetMin = 20;
-        source.block(source.rows() / 2 - offsetMin / 2, source.cols() / 2 - offsetMin / 2, offsetMin, offsetMin) = 0;
+    // Fourier coefficient of the image at the frequency of the peak, with the 
+    // origin of the phase at the center of the image (origin of the regression 
+    // of the phase planes). The sum is separable: the rows are weighted first.
+    template<typename _Scalar>
+    static PhasePlane planeOfPeak(const Eigen::Array<_Scalar, Eigen::Dynamic, Eigen::Dynamic>& image, const Eigen::Vector3d& peak, Eigen::RowVectorXcd& rowPhasors, Eigen::RowVectorXcd& columnSums) {
+        int nRows = image.rows();
+        int nCols = image.cols();
+        double a = 2 * PI * (peak.x() - nCols / 2) / nCols;
+        double b = 2 * PI * (peak.y() - nRows / 2) / nRows;
+
+        rowPhasors.resize(nRows);
+        for (int row = 0; row < nRows; row++) {
+            rowPhasors(row) = std::polar(1.0, -b * (row - nRows / 2));
+        }
+        columnSums.resize(nCols);
+        columnSums.noalias() = rowPhasors * image.matrix();
+        std::complex<double> coefficient = 0.0;
+        for (int col = 0; col < nCols; col++) {
+            coefficient += columnSums(col) * std::polar(1.0, -a * (col - nCols / 2));
+        }
+        return PhasePlane(a, b, std::arg(coefficient));
+    }
+
+    PhasePlane Spectrum::peakPlane(const Eigen::ArrayXXd& image, const Eigen::Vector3d& peak) {
+        Eigen::RowVectorXcd rowPhasors, columnSums;
+        return planeOfPeak(image, peak, rowPhasors, columnSums);
+    }
 
+    PhasePlane Spectrum::peakPlane(const Eigen::ArrayXXcd& image, const Eigen::Vector3d& peak) {
+        Eigen::RowVectorXcd rowPhasors, columnSums;
+        return planeOfPeak(image, peak, rowPhasors, columnSums);
+    }
+
+    PhasePlane Spectrum::peakPlane(const Eigen::ArrayXXd& image, const Eigen::Vector3d& peak, Eigen::RowVectorXcd& rowPhasors, Eigen::RowVectorXcd& columnSums) {
+        return planeOfPeak(image, peak, rowPhasors, columnSums);
+    }
+
+    PhasePlane Spectrum::peakPlane(const Eigen::ArrayXXcd& image, const Eigen::Vector3d& peak, Eigen::RowVectorXcd& rowPhasors, Eigen::RowVectorXcd& columnSums) {
+        return planeOfPeak(image, peak, rowPhasors, columnSums);
+    }
+
+    template<typename _Scalar>
+    void Spectrum::trackPeak(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Vector3d& peak, int radius) {
+        int rowMin = std::max((int) source.rows() / 2, (int) peak.y() - radius);
+        int rowMax = std::min((int) source.rows() - 2, (int) peak.y() + radius);
+        int colMin = std::max(1, (int) peak.x() - radius);
+        int colMax = std::min((int) source.cols() - 2, (int) peak.x() + radius);
         double maxValue = -1.0;
-        std::complex<double> complexValue;
-        double norm = 0.0;
-
-        for (int col = 1; col < source.cols()-1; col++) {
-            for (int row = source.rows()/2; row < source.rows()-1; row++) {
-                //complexValue = source(row, col);
-                //norm = complexValue.real() * complexValue.real() + complexValue.imag() * complexValue.imag();
-                norm = std::abs(source(row, col)) + std::abs(source(row - 1, col)) + std::abs(source(row, col - 1)) + std::abs(source(row + 1, col ))+ std::abs(source(row , col +1));
+        peak.z() = 0.0;
+        for (int col = colMin; col <= colMax; col++) {
+            for (int row = rowMin; row <= rowMax; row++) {
+                double norm = std::abs(source(row, col)) + std::abs(source(row - 1, col)) + std::abs(source(row, col - 1)) + std::abs(source(row + 1, col)) + std::abs(source(row, col + 1));
                 if (norm > maxValue) {
                     maxValue = norm;
-                    mainPeak1.x() = col;
-                    mainPeak1.y() = row;
-                    mainPeak1.z() = norm/source.cols()/source.rows()/5; // MAGIC NUMBER
+                    peak.x() = col;
+                    peak.y() = row;
+                    peak.z() = norm / source.cols() / source.rows() / 5; // same MAGIC NUMBER as mainPeakHalfPlane
                 }
             }
         }
-        //std::cout<< "Peak value (half plane method) : " << mainPeak1.z() <<std::endl;
-//        if (mainPeak1.z() < 1e-5) { // MAGIC NUMBER
-//            //cv::imshow("Peaks not found", array2image(source) );
-//            //cv::waitKey();
-//            throw Exception("Houston, we have a problem here, the first peak has not be found.");
-//        }
-        
-        source.block(mainPeak1.y() - 4, mainPeak1.x() - 4, 8, 8) = 0;
-        source.block((source.rows()-mainPeak1.y()) - 4, (source.cols()-mainPeak1.x()) - 4, 8, 8) = 0;
-
-        maxValue = 0;
+    }
 
-        for (int col = 1; col < source.cols()-1; col++) {
-            for (int row = source.rows()/2; row < source.rows()-1; row++) {
-                //complexValue = source(row, col);
-                //norm = complexValue.real() * complexValue.real() + complexValue.imag() * complexValue.imag();
-                norm = std::abs(source(row, col)) + std::abs(source(row - 1, col)) + std::abs(source(row, col - 1)) + std::abs(source(row + 1, col ))+ std::abs(source(row , col +1));
+    template<typename _Scalar>
+    void Spectrum::trackPeak(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& halfSource, int nRows, Eigen::Vector3d& peak, int radius) {
+        int nCols = halfSource.cols();
+        int rowMin = std::max(nRows / 2, (int) peak.y() - radius);
+        int rowMax = std::min(nRows - 2, (int) peak.y() + radius);
+        int colMin = std::max(1, (int) peak.x() - radius);
+        int colMax = std::min(nCols - 2, (int) peak.x() + radius);
+        double maxValue = -1.0;
+        peak.z() = 0.0;
+        for (int col = colMin; col <= colMax; col++) {
+            for (int row = rowMin; row <= rowMax; row++) {
+                double norm = std::abs(hermitianValue(halfSource, nRows, row, col)) + std::abs(hermitianValue(halfSource, nRows, row - 1, col))
+                        + std::abs(hermitianValue(halfSource, nRows, row, col - 1)) + std::abs(hermitianValue(halfSource, nRows, row + 1, col))
+                        + std::abs(hermitianValue(halfSource, nRows, row, col + 1));
                 if (norm > maxValue) {
                     maxValue = norm;
-                    mainPeak2.x() = col;
-                    mainPeak2.y() = row;
-                    mainPeak2.z() = norm/source.cols()/source.rows()/5;
+                    peak.x() = col;
+                    peak.y() = row;
+                    peak.z() = norm / nCols / nRows / 5;
                 }
             }
         }
-        
-        if (mainPeak1.x()<mainPeak2.x()) {
-            std::swap(mainPeak1,mainPeak2);
-        }
-        
-//        std::cout<<"Image size"<<source.rows()<<"x"<<source.cols()<<std::endl;
-//        
-//        std::cout<<"Peak 1"<<mainPeak1<<std::endl;
-//        std::cout<<"Peak 2"<<mainPeak2<<std::endl;
-//        
-        
-        
     }
 
     //    void Spectrum::mainPeakHalfPlane(Eigen::ArrayXXcd& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
@@ -339,105 +627,87 @@ namespace vernier {
     //        }
     //    }
 
-    void Spectrum::mainPeak4Search(Eigen::ArrayXXcd& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
-
-        Eigen::ArrayXXd mainPeakList(0, 4);
-
-        Eigen::ArrayXXcd sourceSave = source;
-
-
-        sourceSave.block(sourceSave.rows() / 2 - 4, sourceSave.cols() / 2 - 4, 8, 8) = 0;
-        sourceSave = sourceSave / 50;
-
-        int offsetMin = source.rows() / 100.0;
-        source.block(source.rows() / 2 - offsetMin / 2, source.cols() / 2 - offsetMin / 2, offsetMin, offsetMin) = 0;
-
-        int count = 0;
-
-        while (mainPeakList.rows() < 10) {
-
-            double maxValue = 0;
-            mainPeakList.conservativeResize(mainPeakList.rows() + 1, mainPeakList.cols());
+    static bool largerSum(const PeakCandidate& peak1, const PeakCandidate& peak2) {
+        return peak1.sum > peak2.sum;
+    }
 
-            for (int col = 0; col < source.cols(); col++) {
-                for (int row = 0; row < source.rows(); row++) {
-                    std::complex<double> complexValue = source(row, col);
-                    double norm = complexValue.real() * complexValue.real() + complexValue.imag() * complexValue.imag();
-                    if (norm > maxValue) {
-                        maxValue = norm;
-                        mainPeakList(mainPeakList.rows() - 1, 0) = col;
-                        mainPeakList(mainPeakList.rows() - 1, 1) = row;
-                        mainPeakList(mainPeakList.rows() - 1, 2) = atan2(row - source.rows() / 2, col - source.cols() / 2);
+    template<typename _Scalar>
+    void Spectrum::mainPeak4Search(const Eigen::Array<std::complex<_Scalar>, Eigen::Dynamic, Eigen::Dynamic>& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
+        int nRows = source.rows();
+        int nCols = source.cols();
+        int offsetMin = nRows / 100.0;
+        std::vector<PeakCandidate> peaks;
+        largestPeaks(source, offsetMin, 10, peaks);
+
+        // Magnitude of the 2x2 block before each peak, without the center and 
+        // the blocks of the larger peaks
+        for (int i = 0; i < (int) peaks.size(); i++) {
+            PeakCandidate& peak = peaks[i];
+            if (peak.row - 1 > 0 && peak.col - 1 > 0 && peak.row + 1 < nRows && peak.col + 1 < nCols) {
+                for (int col = peak.col - 1; col <= peak.col; col++) {
+                    for (int row = peak.row - 1; row <= peak.row; row++) {
+                        bool zeroed = row >= nRows / 2 - offsetMin / 2 && row < nRows / 2 - offsetMin / 2 + offsetMin
+                                && col >= nCols / 2 - offsetMin / 2 && col < nCols / 2 - offsetMin / 2 + offsetMin;
+                        for (int j = 0; j < i; j++) {
+                            zeroed = zeroed || inPeakBlock(row, col, peaks[j], nRows, nCols);
+                        }
+                        if (!zeroed) {
+                            peak.sum += std::abs(source(row, col));
+                        }
                     }
                 }
             }
-
-            double sum;
-            if (mainPeakList(mainPeakList.rows() - 1, 1) - 1 > 0 && mainPeakList(mainPeakList.rows() - 1, 0) - 1 > 0 && mainPeakList(mainPeakList.rows() - 1, 1) + 1 < source.rows() && mainPeakList(mainPeakList.rows() - 1, 0) + 1 < source.cols()) {
-                sum = source.block(mainPeakList(mainPeakList.rows() - 1, 1) - 1, mainPeakList(mainPeakList.rows() - 1, 0) - 1, 2, 2).abs().sum();
-                mainPeakList(mainPeakList.rows() - 1, 3) = sum;
-            } else {
-                sum = 0;
-                mainPeakList(mainPeakList.rows() - 1, 3) = sum;
-            }
-
-            if (mainPeakList(mainPeakList.rows() - 1, 1) - 4 > 0 && mainPeakList(mainPeakList.rows() - 1, 0) - 4 > 0 && mainPeakList(mainPeakList.rows() - 1, 1) + 4 < source.rows() && mainPeakList(mainPeakList.rows() - 1, 0) + 4 < source.cols()) {
-                source.block(mainPeakList(mainPeakList.rows() - 1, 1) - 4, mainPeakList(mainPeakList.rows() - 1, 0) - 4, 8, 8) = 0;
-            } else {
-                source(mainPeakList(mainPeakList.rows() - 1, 1), mainPeakList(mainPeakList.rows() - 1, 0)) = 0;
-            }
-
-            count++;
-
-        }
-
-        Eigen::ArrayXXd mainPeakListOrderedMag(mainPeakList.rows(), mainPeakList.cols());
-        for (int k = 0; k < mainPeakList.rows(); k++) {
-            double maxSum = 0;
-            int iterator = 0;
-            for (int i = 0; i < mainPeakList.rows(); i++) {
-                if (mainPeakList(i, 3) > maxSum) {
-                    maxSum = mainPeakList(i, 3);
-                    iterator = i;
-                }
-            }
-            mainPeakListOrderedMag.block(k, 0, 1, mainPeakList.cols()) = mainPeakList.block(iterator, 0, 1, mainPeakList.cols());
-            mainPeakList(iterator, 3) = 0;
-        }
-
-        Eigen::ArrayXXd mainPeakListReduced = mainPeakListOrderedMag.block(0, 0, 4, mainPeakListOrderedMag.cols());
-        Eigen::ArrayXXd mainPeakListOrdered(mainPeakListReduced.rows(), mainPeakList.cols());
-        for (int k = 0; k < mainPeakListReduced.rows(); k++) {
-            double minAngle = 10e10;
-            int iterator = 0;
-            for (int i = 0; i < mainPeakListReduced.rows(); i++) {
-                if (mainPeakListReduced(i, 2) < minAngle) {
-                    minAngle = mainPeakListReduced(i, 2);
-                    iterator = i;
-                }
-            }
-            mainPeakListOrdered.block(k, 0, 1, mainPeakListReduced.cols()) = mainPeakListReduced.block(iterator, 0, 1, mainPeakList.cols());
-            mainPeakListReduced(iterator, 2) = 10e6;
-        }
-
-        if (mainPeakListOrdered(3, 2) > 7.0 * PI / 8.0) {
-            mainPeak1.x() = mainPeakListOrdered(1, 0);
-            mainPeak1.y() = mainPeakListOrdered(1, 1);
-            mainPeak2.x() = mainPeakListOrdered(2, 0);
-            mainPeak2.y() = mainPeakListOrdered(2, 1);
-        } else {
-            mainPeak1.x() = mainPeakListOrdered(2, 0);
-            mainPeak1.y() = mainPeakListOrdered(2, 1);
-            mainPeak2.x() = mainPeakListOrdered(3, 0);
-            mainPeak2.y() = mainPeakListOrdered(3, 1);
         }
 
-        source = sourceSave;
+        // The four strongest peaks ordered by angle
+        std::stable_sort(peaks.begin(), peaks.end(), largerSum);
+        peaks.resize(4);
+        std::sort(peaks.begin(), peaks.end(), smallerAngle);
 
+        int first = (peaks[3].angle > 7.0 * PI / 8.0) ? 1 : 2;
+        mainPeak1.x() = peaks[first].col;
+        mainPeak1.y() = peaks[first].row;
+        mainPeak2.x() = peaks[first + 1].col;
+        mainPeak2.y() = peaks[first + 1].row;
     }
 
     double Spectrum::getDistancePoints(double x1, double y1, double x2, double y2) {
         return sqrt(pow(x2 - x1, 2) + pow(y2 - y1, 2));
     }
 
-}
\ No newline at end of file
+    // Explicit instantiations for the double and single precision spectra
+
+    template void Spectrum::shift(Eigen::ArrayXXcd&, Eigen::ArrayXXcd&);
+    template void Spectrum::shift(Eigen::ArrayXXcf&, Eigen::ArrayXXcf&);
+    template void Spectrum::shiftHermitian(const Eigen::ArrayXXcd&, int, Eigen::ArrayXXcd&);
+    template void Spectrum::shiftHermitian(const Eigen::ArrayXXcf&, int, Eigen::ArrayXXcf&);
+    template void Spectrum::mainPeakCircle(Eigen::ArrayXXcd&, Eigen::Vector3d&, Eigen::Vector3d&, double);
+    template void Spectrum::mainPeakCircle(Eigen::ArrayXXcf&, Eigen::Vector3d&, Eigen::Vector3d&, double);
+    template void Spectrum::mainPeakQuarter(Eigen::ArrayXXcd&, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::mainPeakQuarter(Eigen::ArrayXXcf&, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::mainPeakPerimeter(const Eigen::ArrayXXcd&, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::mainPeakPerimeter(const Eigen::ArrayXXcf&, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::mainPeakHalfPlane(const Eigen::ArrayXXcd&, Eigen::ArrayXXd&, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::mainPeakHalfPlane(const Eigen::ArrayXXcf&, Eigen::ArrayXXf&, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::mainPeakHalfPlane(const Eigen::ArrayXXcd&, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::mainPeakHalfPlane(const Eigen::ArrayXXcf&, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::mainPeakHalfPlane(const Eigen::ArrayXXcd&, int, Eigen::ArrayXXd&, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::mainPeakHalfPlane(const Eigen::ArrayXXcf&, int, Eigen::ArrayXXf&, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::mainPeakHalfPlane(const Eigen::ArrayXXcd&, int, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::mainPeakHalfPlane(const Eigen::ArrayXXcf&, int, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::mainPeakAnnulus(const Eigen::ArrayXXcd&, const std::vector<int>&, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::mainPeakAnnulus(const Eigen::ArrayXXcf&, const std::vector<int>&, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::mainPeakAnnulus(const Eigen::ArrayXXcd&, int, const std::vector<int>&, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::mainPeakAnnulus(const Eigen::ArrayXXcf&, int, const std::vector<int>&, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::refinePeak(const Eigen::ArrayXXcd&, Eigen::Vector3d&);
+    template void Spectrum::refinePeak(const Eigen::ArrayXXcf&, Eigen::Vector3d&);
+    template void Spectrum::refinePeak(const Eigen::ArrayXXcd&, int, Eigen::Vector3d&);
+    template void Spectrum::refinePeak(const Eigen::ArrayXXcf&, int, Eigen::Vector3d&);
+    template void Spectrum::trackPeak(const Eigen::ArrayXXcd&, Eigen::Vector3d&, int);
+    template void Spectrum::trackPeak(const Eigen::ArrayXXcf&, Eigen::Vector3d&, int);
+    template void Spectrum::trackPeak(const Eigen::ArrayXXcd&, int, Eigen::Vector3d&, int);
+    template void Spectrum::trackPeak(const Eigen::ArrayXXcf&, int, Eigen::Vector3d&, int);
+    template void Spectrum::mainPeak4Search(const Eigen::ArrayXXcd&, Eigen::Vector3d&, Eigen::Vector3d&);
+    template void Spectrum::mainPeak4Search(const Eigen::ArrayXXcf&, Eigen::Vector3d&, Eigen::Vector3d&);
+
+}
\ No newline at end of file
@@ -62,6 +62,7 @@ namespace vernier {
         detector.compute(image);
 
         stamps.clear();
+        snapshots.resize(detector.squares.size());
         for (int i = 0; i < detector.squares.size(); i++) {
 
             Square square = detector.squares[i];
@@ -73,33 +74,41 @@ namespace vernier {
                 throw Exception("The QRCode is too tiny for pose estimation: increase the picture quality size.");
             }
 
+            takeSnapshot((int) square.getCenter().x, (int) square.getCenter().y, image);
+            snapshots[i] = snapshot;
+        }
+        patternPhase.computeBatch(snapshots);
+
+        for (int i = 0; i < (int) detector.squares.size(); i++) {
+
+            Square square = detector.squares[i];
             int centerX = (int) square.getCenter().x;
             int centerY = (int) square.getCenter().y;
-            takeSnapshot(centerX, centerY, image);
-            patternPhase.compute(snapshot);
+            PhasePlane plane1 = patternPhase.getBatchPlane1(i);
+            PhasePlane plane2 = patternPhase.getBatchPlane2(i);
 
             double alpha;
             double dx, dy;
-            double diffAngle = angleInPiPi(patternPhase.getPlane1().getAngle() - square.getAngle());
+            double diffAngle = angleInPiPi(plane1.getAngle() - square.getAngle());
             if (diffAngle >= -PI / 4 && diffAngle <= PI / 4) {
-                alpha = patternPhase.getPlane1().getAngle();
-                dx = -patternPhase.getPlane1().getPosition(physicalPeriod, 0.0, 0.0);
-                dy = -patternPhase.getPlane2().getPosition(physicalPeriod, 0.0, 0.0);
+                alpha = plane1.getAngle();
+                dx = -plane1.getPosition(physicalPeriod, 0.0, 0.0);
+                dy = -plane2.getPosition(physicalPeriod, 0.0, 0.0);
             } else if (diffAngle >= 3 * PI / 4 || diffAngle <= -3 * PI / 4) {
-                alpha = patternPhase.getPlane1().getAngle() + PI;
-                dx = +patternPhase.getPlane1().getPosition(physicalPeriod, 0.0, 0.0);
-                dy = +patternPhase.getPlane2().getPosition(physicalPeriod, 0.0, 0.0);
+                alpha = plane1.getAngle() + PI;
+                dx = +plane1.getPosition(physicalPeriod, 0.0, 0.0);
+                dy = +plane2.getPosition(physicalPeriod, 0.0, 0.0);
             } else if (diffAngle >= PI / 4 && diffAngle <= 3 * PI / 4) {
-                alpha = patternPhase.getPlane1().getAngle() - PI / 2;
-                dx = patternPhase.getPlane2().getPosition(physicalPeriod, 0.0, 0.0);
-                dy = -patternPhase.getPlane1().getPosition(physicalPeriod, 0.0, 0.0);
+                alpha = plane1.getAngle() - PI / 2;
+                dx = plane2.getPosition(physicalPeriod, 0.0, 0.0);
+                dy = -plane1.getPosition(physicalPeriod, 0.0, 0.0);
             } else {
-                alpha = patternPhase.getPlane1().getAngle() + PI / 2;
-                dx = -patternPhase.getPlane2().getPosition(physicalPeriod, 0.0, 0.0);
-                dy = patternPhase.getPlane1().getPosition(physicalPeriod, 0.0, 0.0);
+                alpha = plane1.getAngle() + PI / 2;
+                dx = -plane2.getPosition(physicalPeriod, 0.0, 0.0);
+                dy = plane1.getPosition(physicalPeriod, 0.0, 0.0);
             }
 
-            double pixelSize = physicalPeriod / patternPhase.getPixelPeriod();
+            double pixelSize = physicalPeriod / plane1.getPixelicPeriod();
             double xImg = (centerX - image.cols / 2);
             double yImg = (centerY - image.rows / 2);
             double x = pixelSize * (xImg * cos(alpha) - yImg * sin(-alpha)) + dx;
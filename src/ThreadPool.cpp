@@ -0,0 +1,106 @@
+/* 
+ * This file is part of the VERNIER Library.
+ *
+ * Copyright (c) 2018-2025 CNRS, ENSMM, UMLP.
+ */
+
+#include "ThreadPool.hpp"
+#include "Exception.hpp"
+
+namespace vernier {
+
+    ThreadPool::ThreadPool(int nThreads) {
+        loopCount = 0;
+        runningWorkers = 0;
+        stopping = false;
+        partRunner = NULL;
+        function = NULL;
+        this->nThreads = 1;
+        setNumberOfThreads(nThreads);
+    }
+
+    ThreadPool::ThreadPool(const ThreadPool& pool) : ThreadPool(pool.nThreads) {
+    }
+
+    ThreadPool& ThreadPool::operator=(const ThreadPool& pool) {
+        setNumberOfThreads(pool.nThreads);
+        return *this;
+    }
+
+    ThreadPool::~ThreadPool() {
+        stopWorkers();
+    }
+
+    void ThreadPool::setNumberOfThreads(int nThreads) {
+        if (nThreads < 1) {
+            throw Exception("The number of threads of a ThreadPool must be positive.");
+        }
+        if (nThreads != this->nThreads) {
+            stopWorkers();
+        }
+        this->nThreads = nThreads;
+    }
+
+    int ThreadPool::getNumberOfThreads() {
+        return nThreads;
+    }
+
+    void ThreadPool::stopWorkers() {
+        if (workers.empty()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(workersMutex);
+            stopping = true;
+            loopCount++;
+        }
+        loopStarted.notify_all();
+        for (int i = 0; i < (int) workers.size(); i++) {
+            workers[i].join();
+        }
+        workers.clear();
+        stopping = false;
+    }
+
+    void ThreadPool::runWorker(int part, int lastLoop) {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(workersMutex);
+                loopStarted.wait(lock, [&] {
+                    return loopCount != lastLoop;
+                });
+                lastLoop = loopCount;
+                if (stopping) {
+                    return;
+                }
+            }
+            partRunner(function, part, nThreads);
+            std::lock_guard<std::mutex> lock(workersMutex);
+            if (--runningWorkers == 0) {
+                loopFinished.notify_one();
+            }
+        }
+    }
+
+    void ThreadPool::runLoop(void (*partRunner)(const void*, int, int), const void* function) {
+        if ((int) workers.size() != nThreads - 1) {
+            stopWorkers();
+            for (int i = 1; i < nThreads; i++) {
+                workers.push_back(std::thread(&ThreadPool::runWorker, this, i, loopCount));
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(workersMutex);
+            this->partRunner = partRunner;
+            this->function = function;
+            runningWorkers = workers.size();
+            loopCount++;
+        }
+        loopStarted.notify_all();
+        partRunner(function, 0, nThreads);
+        std::unique_lock<std::mutex> lock(workersMutex);
+        loopFinished.wait(lock, [&] {
+            return runningWorkers == 0;
+        });
+    }
+}
@@ -5,6 +5,7 @@
  */
 
 #include "Utils.hpp"
+#include <cfloat>
 
 namespace vernier {
 
@@ -50,21 +51,66 @@ namespace vernier {
         return array2image(spectrumAbs);
     }
 
+    cv::Mat array2image(const Eigen::ArrayXXf & array) {
+        Eigen::ArrayXXd arrayDouble;
+        arrayDouble = array.cast<double>();
+        return array2image(arrayDouble);
+    }
+
+    cv::Mat array2image(const Eigen::ArrayXXcf & array) {
+        Eigen::ArrayXXd spectrumAbs;
+        spectrumAbs = array.abs().cast<double>();
+        return array2image(spectrumAbs);
+    }
+
     Eigen::ArrayXXd image2array(const cv::Mat & image) {
-        cv::Mat grayImage;
+        Eigen::ArrayXXd patternArray;
+        image2array(image, patternArray);
+        return patternArray;
+    }
+
+    // Same affine transform as cv::normalize with cv::NORM_MINMAX
+    template<typename _Pixel>
+    static void normalizedCopy(const cv::Mat & image, Eigen::ArrayXXd & array, double scale, double shift) {
+        for (int row = 0; row < image.rows; row++) {
+            const _Pixel* pixels = image.ptr<_Pixel>(row);
+            for (int col = 0; col < image.cols; col++) {
+                array(row, col) = pixels[col] * scale + shift;
+            }
+        }
+    }
+
+    void image2array(const cv::Mat & image, Eigen::ArrayXXd & array) {
         if (image.channels() > 1) {
+            cv::Mat grayImage;
             cv::cvtColor(image, grayImage, cv::COLOR_BGR2GRAY);
-        } else {
-            grayImage = image;
+            image2array(grayImage, array);
+            return;
         }
 
-        grayImage.convertTo(grayImage, CV_64F);
-        cv::normalize(grayImage, grayImage, 1.0, 0, cv::NORM_MINMAX);
-        Eigen::MatrixXd patternMatrix;
-        cv::cv2eigen(grayImage, patternMatrix);
-        Eigen::ArrayXXd patternArray;
-        patternArray = patternMatrix.array();
-        return patternArray;
+        double minValue, maxValue;
+        cv::minMaxLoc(image, &minValue, &maxValue);
+        double scale = (maxValue - minValue > DBL_EPSILON) ? 1.0 / (maxValue - minValue) : 0.0;
+        double shift = -minValue * scale;
+        array.resize(image.rows, image.cols);
+        switch (image.depth()) {
+            case CV_8U: normalizedCopy<uchar>(image, array, scale, shift);
+                break;
+            case CV_8S: normalizedCopy<schar>(image, array, scale, shift);
+                break;
+            case CV_16U: normalizedCopy<ushort>(image, array, scale, shift);
+                break;
+            case CV_16S: normalizedCopy<short>(image, array, scale, shift);
+                break;
+            case CV_32S: normalizedCopy<int>(image, array, scale, shift);
+                break;
+            case CV_32F: normalizedCopy<float>(image, array, scale, shift);
+                break;
+            case CV_64F: normalizedCopy<double>(image, array, scale, shift);
+                break;
+            default:
+                throw Exception("Unsupported depth of the image.");
+        }
     }
 
     void imageTo8UC1(const cv::Mat& image, cv::Mat& grayscaleImage) {
@@ -121,4 +167,4 @@ namespace vernier {
         return buf;
     }
 
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -8,6 +8,8 @@
 #include "UnitTest.hpp"
 #include <complex>
 #include <random>
+#include <cstdio>
+#include <thread>
 
 using namespace vernier;
 using namespace std;
@@ -105,6 +107,118 @@ void runAllTests() {
     }
 
     UNIT_TEST(areEqual(spectral, spectralAnalytic, 1e-12));
+
+    // Real-to-complex transform gives the first half of the complex spectrum
+    Eigen::ArrayXXd realSpatial = Eigen::ArrayXXd::Random(32, 16);
+    Eigen::ArrayXXcd complexSpatial(realSpatial.rows(), realSpatial.cols());
+    complexSpatial.real() = realSpatial;
+    complexSpatial.imag().setZero();
+    Eigen::ArrayXXcd complexSpectrum, halfSpectrum;
+
+    FourierTransform fft2D, fftReal;
+    fft2D.compute(complexSpatial, complexSpectrum);
+    fftReal.compute(realSpatial, halfSpectrum);
+
+    Eigen::ArrayXXcd complexSpectrumTop = complexSpectrum.topRows(realSpatial.rows() / 2 + 1);
+    UNIT_TEST(halfSpectrum.rows() == realSpatial.rows() / 2 + 1);
+    UNIT_TEST(areEqual(halfSpectrum, complexSpectrumTop, 1e-12));
+
+    // Complex-to-real transform gives back the real array (unnormalized) without modifying the spectrum
+    Eigen::ArrayXXcd halfSpectrumCopy = halfSpectrum;
+    Eigen::ArrayXXd realSpatialBack;
+    FourierTransform ifftReal;
+    ifftReal.resize(realSpatial.rows(), realSpatial.cols(), FFTW_BACKWARD, true);
+    ifftReal.compute(halfSpectrum, realSpatialBack);
+
+    realSpatialBack /= realSpatial.size();
+    UNIT_TEST(areEqual(realSpatialBack, realSpatial, 1e-12));
+    UNIT_TEST(areEqual(halfSpectrum, halfSpectrumCopy));
+
+    // The planner rigor changes the plan, not the result
+    Eigen::ArrayXXcd complexSpectrumEstimate;
+    FourierTransform fftEstimate(complexSpatial.rows(), complexSpatial.cols());
+    fftEstimate.setPlannerFlags(FourierTransform::getPlannerFlags("estimate"));
+    fftEstimate.compute(complexSpatial, complexSpectrumEstimate);
+    UNIT_TEST(fftEstimate.getPlannerFlags() == FFTW_ESTIMATE);
+    UNIT_TEST(areEqual(complexSpectrumEstimate, complexSpectrum, 1e-12));
+
+    // Multi-threaded transforms give the same result
+    Eigen::ArrayXXcd complexSpectrumThreads;
+    FourierTransform fftThreads;
+    fftThreads.setNumberOfThreads(3);
+    fftThreads.compute(complexSpatial, complexSpectrumThreads);
+    UNIT_TEST(areEqual(complexSpectrumThreads, complexSpectrum, 1e-12));
+
+    // Any size is supported (Bluestein's algorithm without FFTW)
+    Eigen::ArrayXXcd oddSpatial = Eigen::ArrayXXcd::Random(15, 12);
+    Eigen::ArrayXXcd oddSpectrum, oddSpectrumThreads, oddSpatialBack;
+    Eigen::ArrayXXcd oddSpectrumAnalytic(oddSpatial.rows(), oddSpatial.cols());
+    for (int k = 0; k < oddSpatial.rows(); k++) {
+        for (int l = 0; l < oddSpatial.cols(); l++) {
+            std::complex<double> sum = 0;
+            for (int i = 0; i < oddSpatial.rows(); i++) {
+                for (int j = 0; j < oddSpatial.cols(); j++) {
+                    sum += oddSpatial(i, j) * std::polar(1.0, -2 * PI * ((double) (i * k) / oddSpatial.rows() + (double) (j * l) / oddSpatial.cols()));
+                }
+            }
+            oddSpectrumAnalytic(k, l) = sum;
+        }
+    }
+    FourierTransform fftOdd, ifftOdd(oddSpatial, FFTW_BACKWARD), fftOddThreads;
+    fftOdd.compute(oddSpatial, oddSpectrum);
+    UNIT_TEST(areEqual(oddSpectrum, oddSpectrumAnalytic, 1e-12));
+    fftOddThreads.setNumberOfThreads(2);
+    fftOddThreads.compute(oddSpatial, oddSpectrumThreads);
+    UNIT_TEST(areEqual(oddSpectrumThreads, oddSpectrumAnalytic, 1e-12));
+    ifftOdd.compute(oddSpectrum, oddSpatialBack);
+    oddSpatialBack /= oddSpatial.size();
+    UNIT_TEST(areEqual(oddSpatialBack, oddSpatial, 1e-12));
+
+    Eigen::ArrayXXd oddRealSpatial = oddSpatial.real();
+    Eigen::ArrayXXcd oddComplexSpatial(oddRealSpatial.rows(), oddRealSpatial.cols()), oddComplexSpectrum, oddHalfSpectrum;
+    oddComplexSpatial.real() = oddRealSpatial;
+    oddComplexSpatial.imag().setZero();
+    FourierTransform fftOddComplex, fftOddReal;
+    fftOddComplex.compute(oddComplexSpatial, oddComplexSpectrum);
+    fftOddReal.compute(oddRealSpatial, oddHalfSpectrum);
+    Eigen::ArrayXXcd oddComplexSpectrumTop = oddComplexSpectrum.topRows(oddRealSpatial.rows() / 2 + 1);
+    UNIT_TEST(areEqual(oddHalfSpectrum, oddComplexSpectrumTop, 1e-12));
+
+    // A batch gives the same transforms as separate computations
+    Eigen::ArrayXXcd batchSpatial = Eigen::ArrayXXcd::Random(16, 3 * 12);
+    Eigen::ArrayXXcd batchSpectrum, batchSpectrumSeparate(batchSpatial.rows(), batchSpatial.cols());
+    Eigen::ArrayXXcd snapshotSpatial, snapshotSpectrum;
+    FourierTransform fftBatch, fftSnapshot;
+    fftBatch.computeBatch(batchSpatial, batchSpectrum, 3);
+    for (int i = 0; i < 3; i++) {
+        snapshotSpatial = batchSpatial.middleCols(12 * i, 12);
+        fftSnapshot.compute(snapshotSpatial, snapshotSpectrum);
+        batchSpectrumSeparate.middleCols(12 * i, 12) = snapshotSpectrum;
+    }
+    UNIT_TEST(fftBatch.getBatchSize() == 3);
+    UNIT_TEST(areEqual(batchSpectrum, batchSpectrumSeparate, 1e-12));
+
+    // 1-D transform of any size
+    Eigen::ArrayXcd vectorSpatial = Eigen::ArrayXcd::Random(100);
+    Eigen::ArrayXcd vectorSpectrum;
+    Eigen::ArrayXcd vectorSpectrumAnalytic(vectorSpatial.rows());
+    for (int k = 0; k < vectorSpatial.rows(); k++) {
+        std::complex<double> sum = 0;
+        for (int i = 0; i < vectorSpatial.rows(); i++) {
+            sum += vectorSpatial(i) * std::polar(1.0, -2 * PI * (double) (i * k) / vectorSpatial.rows());
+        }
+        vectorSpectrumAnalytic(k) = sum;
+    }
+    FourierTransform fftVector;
+    fftVector.compute(vectorSpatial, vectorSpectrum);
+    UNIT_TEST(areEqual(vectorSpectrum, vectorSpectrumAnalytic, 1e-12));
+
+#ifdef USE_FFTW
+    std::string wisdomFilename = std::tmpnam(NULL);
+    UNIT_TEST(FourierTransform::exportWisdom(wisdomFilename));
+    UNIT_TEST(FourierTransform::importWisdom(wisdomFilename));
+    std::remove(wisdomFilename.c_str());
+#endif
 }
 
 double speed(unsigned long testCount) {
@@ -121,9 +235,84 @@ double speed(unsigned long testCount) {
     return toc(testCount);
 }
 
+double speedNonPowerOfTwo(unsigned long testCount) {
+    Eigen::ArrayXXcd spatial = Eigen::ArrayXXcd::Random(1200, 1920);
+    Eigen::ArrayXXcd spectral(spatial);
+
+    FourierTransform ft(spatial);
+
+    tic();
+    for (unsigned long i = 0; i < testCount; i++) {
+        ft.compute(spatial, spectral);
+    }
+
+    return toc(testCount);
+}
+
+double speedBatch(unsigned long testCount) {
+    int batchSize = 50;
+    Eigen::ArrayXXcd spatial = Eigen::ArrayXXcd::Random(128, 128 * batchSize);
+    Eigen::ArrayXXcd spectral(spatial);
+
+    FourierTransform ft;
+    ft.resizeBatch(128, 128, batchSize);
+
+    tic();
+    for (unsigned long i = 0; i < testCount; i++) {
+        ft.computeBatch(spatial, spectral, batchSize);
+    }
+
+    return toc(testCount);
+}
+
+double speedReal(unsigned long testCount) {
+    Eigen::ArrayXXd spatial = Eigen::ArrayXXd::Random(512, 512);
+    Eigen::ArrayXXcd spectral;
+
+    FourierTransform ft;
+    ft.resize(spatial.rows(), spatial.cols(), FFTW_FORWARD, true);
+
+    tic();
+    for (unsigned long i = 0; i < testCount; i++) {
+        ft.compute(spatial, spectral);
+    }
+
+    return toc(testCount);
+}
+
+/** Computing time of a size x size complex transform with a given number of threads */
+double speedThreads(int nThreads, int size, unsigned long testCount) {
+    Eigen::ArrayXXcd spatial = Eigen::ArrayXXcd::Random(size, size);
+    Eigen::ArrayXXcd spectral(spatial);
+
+    FourierTransform ft(spatial);
+    ft.setNumberOfThreads(nThreads);
+    ft.compute(spatial, spectral);
+
+    tic();
+    for (unsigned long i = 0; i < testCount; i++) {
+        ft.compute(spatial, spectral);
+    }
+
+    return toc(testCount);
+}
+
 int main(int argc, char** argv) {
 
     runAllTests();
 
+    // Benchmarks, run on demand: TestFourierTransform speed [maximal number of threads]
+    if (argc > 1 && string(argv[1]) == "speed") {
+        int maxThreads = (argc > 2) ? atoi(argv[2]) : std::max(1, (int) std::thread::hardware_concurrency());
+        for (int size = 256; size <= 4096; size *= 4) {
+            double time1 = 0.0;
+            for (int nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+                double time = speedThreads(nThreads, size, 10);
+                time1 = (nThreads == 1) ? time : time1;
+                cout << size << " pixels, " << nThreads << " threads: " << time << " ms (speed-up " << time1 / time << ")" << endl;
+            }
+        }
+    }
+
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -34,6 +34,14 @@ void runAllTests() {
     Eigen::ArrayXXcd filter2 = Eigen::ArrayXXcd::Ones(512, 768);
     GaussianFilter(15).applyTo(filter2, 256, 128);
     UNIT_TEST(areEqual(filter2, filter1));
+
+    // Changing sigma without changing the kernel size updates the kernel
+    GaussianFilter filter3(1.0);
+    filter3.setSigma(1.02);
+    Eigen::ArrayXXd kernel3 = filter3.getKernel();
+    Eigen::ArrayXXd kernel4 = GaussianFilter(1.02).getKernel();
+    UNIT_TEST(kernel3.rows() == GaussianFilter(1.0).getKernel().rows());
+    UNIT_TEST(areEqual(kernel3, kernel4));
 }
 
 double speed(unsigned long testCount = 10) {
@@ -9,10 +9,109 @@
 #include "PeriodicPatternLayout.hpp"
 #include "eigen-matio/MatioFile.hpp"
 #include <random>
+#include <fstream>
+#include <iomanip>
+#include <cerrno>
+#include <thread>
+#include <atomic>
 
 using namespace vernier;
 using namespace std;
 
+// Test-only allocation counter: the replaced allocation functions count the 
+// heap allocations while countingAllocations is set. With glibc, malloc itself
+// is replaced since Eigen does not allocate through operator new, and so are 
+// the aligned allocations (FFTW, aligned Eigen builds). The allocations of 
+// all the threads are counted.
+static std::atomic<bool> countingAllocations(false);
+static std::atomic<long> allocationCount(0);
+
+#ifdef __GLIBC__
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+    void* __libc_memalign(size_t alignment, size_t size);
+
+    void* malloc(size_t size) {
+        allocationCount += countingAllocations;
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) {
+        allocationCount += countingAllocations;
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, size_t size) {
+        allocationCount += countingAllocations;
+        return __libc_realloc(pointer, size);
+    }
+
+    void* memalign(size_t alignment, size_t size) {
+        allocationCount += countingAllocations;
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size) {
+        allocationCount += countingAllocations;
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** pointer, size_t alignment, size_t size) {
+        allocationCount += countingAllocations;
+        *pointer = __libc_memalign(alignment, size);
+        return (*pointer == NULL && size != 0) ? ENOMEM : 0;
+    }
+}
+#else
+void* operator new(size_t size) {
+    allocationCount += countingAllocations;
+    void* pointer = std::malloc(size);
+    if (pointer == NULL) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+#endif
+
+/** Number of heap allocations of a computation once its buffers are sized by two first runs */
+template<typename _Computation>
+long countAllocations(_Computation computation) {
+    computation();
+    computation();
+    allocationCount = 0;
+    countingAllocations = true;
+    computation();
+    countingAllocations = false;
+    return allocationCount;
+}
+
+/** Mean of the Sobel derivative of the fringe derivative map, computed with the 
+ * derivative images of OpenCV (cropped as the regression with its default 
+ * crop factor) */
+double meanSobelFringeDerivative(const Eigen::ArrayXXd& unwrappedPhase, PhasePlane plane, bool alongCols) {
+    int sideOffset = unwrappedPhase.cols() / 4;
+    Eigen::ArrayXXd phaseCropped = unwrappedPhase.block(sideOffset, sideOffset, unwrappedPhase.rows() - 2 * sideOffset, unwrappedPhase.cols() - 2 * sideOffset);
+    double a = plane.getA();
+    double b = plane.getB();
+    cv::Mat phaseDerived(phaseCropped.rows() - 1, phaseCropped.cols() - 1, CV_64FC1);
+    for (int i = 0; i < phaseDerived.rows; i++) {
+        for (int j = 0; j < phaseDerived.cols; j++) {
+            double dX = -(phaseCropped(i + 1, j) - phaseCropped(i, j)) * a / (pow(a, 2) + pow(b, 2));
+            double dY = (phaseCropped(i, j + 1) - phaseCropped(i, j)) * b / (pow(a, 2) + pow(b, 2));
+            phaseDerived.at<double>(i, j) = dX + dY;
+        }
+    }
+    cv::Mat sobel;
+    cv::Sobel(phaseDerived, sobel, CV_64F, alongCols ? 1 : 0, alongCols ? 0 : 1);
+    return cv::mean(sobel)[0];
+}
+
 void main1() {
 
     Eigen::ArrayXXcd mireMatrix;
@@ -40,19 +139,37 @@ void main1() {
 
 }
 
-void runAllTests() {
-    
-    START_UNIT_TEST;
-     
-    double period = 10.0;
+// Test pattern and its reference pose in the images of the tests
+const double period = 10.0;
+const double x = 4.0;
+const double y = 3.0;
+const double alpha = 0.2;
+const double pixelSize = 1.0;
+
+// Tolerance of the planes computed along two paths of the same precision
+const double tolerance = (sizeof (Real) == sizeof (float)) ? 1e-4 : 1e-9;
+
+/** Image of the test pattern at a given pose */
+Eigen::ArrayXXd renderPattern(const Pose& pose, int nRows = 512, int nCols = 512) {
     PeriodicPatternLayout layout(period, 81, 81);
-    double x = 4.0;
-    double y = 3.0;
-    double alpha = 0.2;
-    double pixelSize = 1.0;
-    Pose patternPose = Pose(x, y, alpha, pixelSize);
-    Eigen::ArrayXXd array(512, 512);
-    layout.renderOrthographicProjection(patternPose, array);
+    Eigen::ArrayXXd array(nRows, nCols);
+    layout.renderOrthographicProjection(pose, array);
+    return array;
+}
+
+/** Snapshots of the test pattern at three poses (128 x 128 complex images) */
+std::vector<Eigen::ArrayXXcd> renderSnapshots() {
+    std::vector<Eigen::ArrayXXcd> snapshots(3, Eigen::ArrayXXcd::Zero(128, 128));
+    for (int i = 0; i < (int) snapshots.size(); i++) {
+        snapshots[i].real() = renderPattern(Pose(x + i, y - i, alpha + 0.3 * i, pixelSize), 128, 128);
+    }
+    return snapshots;
+}
+
+void testPhasePlanes() {
+
+    START_UNIT_TEST;
+    Eigen::ArrayXXd array = renderPattern(Pose(x, y, alpha, pixelSize));
     PatternPhase patternPhase;
     patternPhase.setSigma(1);
     patternPhase.compute(array);
@@ -72,6 +189,250 @@ void runAllTests() {
 
     UNIT_TEST(areEqual(alpha, patternPhase.getPlane1().getAngle(), 0.001));
 
+    // Once sized by the first images, the computations do not allocate anything
+    UNIT_TEST(countAllocations([&]() { patternPhase.compute(array); }) == 0);
+}
+
+void testBatch() {
+
+    START_UNIT_TEST;
+    // A batch of snapshots gives the same planes as separate computations
+    std::vector<Eigen::ArrayXXcd> snapshots = renderSnapshots();
+    PatternPhase batchPhase, snapshotPhase;
+    batchPhase.computeBatch(snapshots);
+    for (int i = 0; i < (int) snapshots.size(); i++) {
+        snapshotPhase.compute(snapshots[i]);
+        UNIT_TEST(areEqual(batchPhase.getBatchPlane1(i).getA(), snapshotPhase.getPlane1().getA(), tolerance));
+        UNIT_TEST(areEqual(batchPhase.getBatchPlane1(i).getC(), snapshotPhase.getPlane1().getC(), tolerance));
+        UNIT_TEST(areEqual(batchPhase.getBatchPlane2(i).getB(), snapshotPhase.getPlane2().getB(), tolerance));
+        UNIT_TEST(areEqual(batchPhase.getBatchPlane2(i).getC(), snapshotPhase.getPlane2().getC(), tolerance));
+    }
+    UNIT_TEST(countAllocations([&]() { snapshotPhase.compute(snapshots[0]); }) == 0);
+    UNIT_TEST(countAllocations([&]() { batchPhase.computeBatch(snapshots); }) == 0);
+}
+
+void testDecimation() {
+
+    START_UNIT_TEST;
+    Eigen::ArrayXXd array = renderPattern(Pose(x, y, alpha, pixelSize));
+    PatternPhase patternPhase;
+    patternPhase.setSigma(1);
+    patternPhase.compute(array);
+
+    // The decimated phase maps give the same pose
+    PatternPhase decimatedPhase;
+    decimatedPhase.setSigma(1);
+    decimatedPhase.setDecimation(4);
+    decimatedPhase.compute(array);
+    UNIT_TEST(decimatedPhase.getDecimationFactor() == 4);
+    UNIT_TEST(decimatedPhase.getUnwrappedPhase1().rows() == array.rows() / 4);
+    UNIT_TEST(areEqual(y, -decimatedPhase.getPlane2().getPosition(period), 0.001));
+    UNIT_TEST(areEqual(alpha, decimatedPhase.getPlane1().getAngle(), 0.001));
+    UNIT_TEST(areEqual(patternPhase.getPlane1().getPixelicPeriod(), decimatedPhase.getPlane1().getPixelicPeriod(), 0.001));
+
+    // The control images of the decimated maps have the size of the image
+    cv::Mat fringesImage = decimatedPhase.getFringesImage();
+    UNIT_TEST(fringesImage.rows == array.rows() && fringesImage.cols == array.cols());
+    UNIT_TEST(!decimatedPhase.getPeaksImage().empty());
+    UNIT_TEST(countAllocations([&]() { decimatedPhase.compute(array); }) == 0);
+}
+
+void testTracking() {
+
+    START_UNIT_TEST;
+    // The peaks tracked along a slowly moving sequence are the ones of the global search
+    PatternPhase patternPhase, trackingPhase;
+    patternPhase.setSigma(1);
+    trackingPhase.setSigma(1);
+    trackingPhase.setTracking(true);
+    Eigen::ArrayXXd array;
+    for (int i = 0; i < 5; i++) {
+        array = renderPattern(Pose(x + 0.7 * i, y - 0.4 * i, alpha + 0.01 * i, pixelSize));
+        patternPhase.compute(array);
+        trackingPhase.compute(array);
+        UNIT_TEST(areEqual(patternPhase.getPlane1().getA(), trackingPhase.getPlane1().getA(), 1e-12));
+        UNIT_TEST(areEqual(patternPhase.getPlane2().getC(), trackingPhase.getPlane2().getC(), 1e-12));
+    }
+    UNIT_TEST(countAllocations([&]() { trackingPhase.compute(array); }) == 0);
+}
+
+void testCenteredSpectra() {
+
+    START_UNIT_TEST;
+    // The spectrum of the unmodulated computations (of the zero mean image) 
+    // is centered as the one of compute
+    Eigen::ArrayXXd array = renderPattern(Pose(x, y, alpha, pixelSize));
+    Eigen::ArrayXXcd qrArray = array.cast<std::complex<double> >();
+    PatternPhase complexPhase, circlePhase;
+    complexPhase.setSigma(1);
+    complexPhase.compute(qrArray - qrArray.mean());
+    Eigen::ArrayXXcr centeredSpectrum = complexPhase.getSpectrum();
+    circlePhase.setPixelPeriod(period);
+    circlePhase.setPeaksSearchMethod(3);
+    double firstPixelPeriod;
+    circlePhase.computeFirst(qrArray, firstPixelPeriod);
+    UNIT_TEST(((centeredSpectrum - circlePhase.getSpectrum()).abs().maxCoeff() < 1e-5 * centeredSpectrum.abs().maxCoeff()));
+    circlePhase.computeQRCode(qrArray);
+    UNIT_TEST(((centeredSpectrum - circlePhase.getSpectrum()).abs().maxCoeff() < 1e-5 * centeredSpectrum.abs().maxCoeff()));
+    UNIT_TEST(countAllocations([&]() { circlePhase.compute(array); }) == 0);
+    UNIT_TEST(countAllocations([&]() { circlePhase.computeQRCode(qrArray); }) == 0);
+    UNIT_TEST(countAllocations([&]() { circlePhase.computeFirst(qrArray, firstPixelPeriod); }) == 0);
+    int betaSign, gammaSign;
+    UNIT_TEST(countAllocations([&]() { circlePhase.computeWeakPerspective(qrArray, betaSign, gammaSign, period); }) == 0);
+    UNIT_TEST(countAllocations([&]() { circlePhase.computeWeakPerspective(array, betaSign, gammaSign, period); }) == 0);
+}
+
+void testUnwrapFree() {
+
+    START_UNIT_TEST;
+    Eigen::ArrayXXd array = renderPattern(Pose(x, y, alpha, pixelSize));
+    PatternPhase patternPhase, decimatedPhase;
+    patternPhase.setSigma(1);
+    patternPhase.compute(array);
+    decimatedPhase.setSigma(1);
+    decimatedPhase.setDecimation(4);
+    decimatedPhase.compute(array);
+
+    // The unwrap-free estimation gives the same planes
+    PatternPhase wrappedPhase;
+    wrappedPhase.setSigma(1);
+    wrappedPhase.setUnwrapping(false);
+    wrappedPhase.compute(array);
+    UNIT_TEST(areEqual(patternPhase.getPlane1().getA(), wrappedPhase.getPlane1().getA(), 1e-6));
+    UNIT_TEST(areEqual(patternPhase.getPlane1().getB(), wrappedPhase.getPlane1().getB(), 1e-6));
+    UNIT_TEST(areEqual(patternPhase.getPlane1().getC(), wrappedPhase.getPlane1().getC(), 1e-6));
+    UNIT_TEST(areEqual(patternPhase.getPlane2().getC(), wrappedPhase.getPlane2().getC(), 1e-6));
+    wrappedPhase.setDecimation(4);
+    wrappedPhase.compute(array);
+    UNIT_TEST(areEqual(decimatedPhase.getPlane1().getA(), wrappedPhase.getPlane1().getA(), 1e-6));
+    UNIT_TEST(areEqual(decimatedPhase.getPlane2().getC(), wrappedPhase.getPlane2().getC(), 1e-6));
+    UNIT_TEST(areEqual(decimatedPhase.getUnwrappedPhase1(), wrappedPhase.getUnwrappedPhase1()));
+    UNIT_TEST(countAllocations([&]() { wrappedPhase.compute(array); }) == 0);
+}
+
+void testThreads() {
+
+    START_UNIT_TEST;
+    // The unwrapping by several threads gives the same planes, without allocating
+    Eigen::ArrayXXd array = renderPattern(Pose(x, y, alpha, pixelSize));
+    PatternPhase patternPhase, threadsPhase;
+    patternPhase.setSigma(1);
+    patternPhase.compute(array);
+    threadsPhase.setSigma(1);
+    threadsPhase.setNumberOfThreads(3);
+    threadsPhase.compute(array);
+    UNIT_TEST(areEqual(patternPhase.getPlane1().getA(), threadsPhase.getPlane1().getA(), 1e-12));
+    UNIT_TEST(areEqual(patternPhase.getPlane2().getC(), threadsPhase.getPlane2().getC(), 1e-12));
+    UNIT_TEST(countAllocations([&]() { threadsPhase.compute(array); }) == 0);
+}
+
+void testComputeFirst() {
+
+    START_UNIT_TEST;
+    // The width of the Gaussian filter is searched with the pixel period
+    Eigen::ArrayXXd array = renderPattern(Pose(x, y, alpha, pixelSize));
+    Eigen::ArrayXXcd qrArray = array.cast<std::complex<double> >();
+    PatternPhase firstPhase;
+    double firstPixelPeriod;
+    double firstSigma = firstPhase.computeFirst(qrArray, firstPixelPeriod);
+    UNIT_TEST(firstSigma > 0.333 && firstSigma == firstPhase.getSigma());
+    UNIT_TEST(areEqual(firstPixelPeriod, period, 0.05));
+
+    // The sigma found by computeFirst updates the decimation factor
+    PatternPhase firstDecimatedPhase;
+    firstDecimatedPhase.setSigma(1);
+    firstDecimatedPhase.setDecimation(256);
+    firstDecimatedPhase.compute(array);
+    firstDecimatedPhase.computeFirst(qrArray, firstPixelPeriod);
+    PatternPhase sigmaDecimatedPhase;
+    sigmaDecimatedPhase.setSigma(firstDecimatedPhase.getSigma());
+    sigmaDecimatedPhase.setDecimation(256);
+    sigmaDecimatedPhase.compute(array);
+    UNIT_TEST(firstDecimatedPhase.getDecimationFactor() == sigmaDecimatedPhase.getDecimationFactor());
+}
+
+void testPhaseGradients() {
+
+    START_UNIT_TEST;
+    // The signs reduced from the borders of the maps are the ones of the 
+    // means of the derivative images
+    PeriodicPatternLayout layout(period, 81, 81);
+    Eigen::ArrayXXd array(384, 512);
+    PatternPhase patternPhase;
+    int betaSign, gammaSign;
+    for (int i = 0; i < 4; i++) {
+        layout.renderPerspectiveProjection(Pose(x, y, 2000.0, alpha, (i % 2 ? 0.3 : -0.3), (i / 2 ? 0.3 : -0.3)), array, 2000.0);
+        patternPhase.compute(array);
+        patternPhase.computePhaseGradients(betaSign, gammaSign);
+        double mean1 = meanSobelFringeDerivative(patternPhase.getUnwrappedPhase1(), patternPhase.getPlane1(), true);
+        double mean2 = meanSobelFringeDerivative(patternPhase.getUnwrappedPhase2(), patternPhase.getPlane2(), false);
+        UNIT_TEST(mean1 != 0.0 && betaSign == (mean1 > 0) - (mean1 < 0));
+        UNIT_TEST(mean2 != 0.0 && gammaSign == (mean2 > 0) - (mean2 < 0));
+    }
+}
+
+void testAnnulus() {
+
+    START_UNIT_TEST;
+    // The annulus around the period gives the peaks of the global search
+    Eigen::ArrayXXd array = renderPattern(Pose(x, y, alpha, pixelSize));
+    PatternPhase patternPhase, annulusPhase;
+    patternPhase.setSigma(1);
+    patternPhase.compute(array);
+    annulusPhase.setSigma(1);
+    annulusPhase.setPixelPeriodBounds(0.8 * period, 1.2 * period);
+    annulusPhase.compute(array);
+    UNIT_TEST(areEqual(patternPhase.getPlane1().getA(), annulusPhase.getPlane1().getA(), 1e-12));
+    UNIT_TEST(areEqual(patternPhase.getPlane2().getC(), annulusPhase.getPlane2().getC(), 1e-12));
+    UNIT_TEST(countAllocations([&]() { annulusPhase.compute(array); }) == 0);
+}
+
+void testFastMode() {
+
+    START_UNIT_TEST;
+    // The fast mode gives the planes within a hundredth of pixel from the refined peaks
+    Eigen::ArrayXXd array = renderPattern(Pose(x, y, alpha, pixelSize));
+    PatternPhase patternPhase, fastPhase;
+    patternPhase.setSigma(1);
+    patternPhase.compute(array);
+    fastPhase.setFastMode(true);
+    fastPhase.compute(array);
+    UNIT_TEST(fastPhase.isFastMode());
+    UNIT_TEST(areEqual(patternPhase.getPlane1().getA(), fastPhase.getPlane1().getA(), 1e-3));
+    UNIT_TEST(areEqual(patternPhase.getPlane2().getB(), fastPhase.getPlane2().getB(), 1e-3));
+    UNIT_TEST(areEqual(patternPhase.getPlane1().getPosition(period), fastPhase.getPlane1().getPosition(period), 0.01));
+    UNIT_TEST(areEqual(patternPhase.getPlane2().getPosition(period), fastPhase.getPlane2().getPosition(period), 0.01));
+    std::vector<Eigen::ArrayXXcd> snapshots = renderSnapshots();
+    PatternPhase snapshotPhase;
+    fastPhase.compute(snapshots[0]);
+    snapshotPhase.compute(snapshots[0]);
+    UNIT_TEST(areEqual(snapshotPhase.getPlane1().getPosition(period), fastPhase.getPlane1().getPosition(period), 0.01));
+    UNIT_TEST(areEqual(snapshotPhase.getPlane2().getPosition(period), fastPhase.getPlane2().getPosition(period), 0.01));
+    UNIT_TEST(countAllocations([&]() { fastPhase.compute(array); }) == 0);
+}
+
+void testPyramid() {
+
+    START_UNIT_TEST;
+    // The coarse-to-fine search on the binned images gives the peaks of the global search
+    Eigen::ArrayXXd array = renderPattern(Pose(x, y, alpha, pixelSize));
+    PatternPhase patternPhase, pyramidPhase;
+    patternPhase.setSigma(1);
+    patternPhase.compute(array);
+    pyramidPhase.setSigma(1);
+    pyramidPhase.setPyramidFactor(4);
+    pyramidPhase.compute(array);
+    UNIT_TEST(pyramidPhase.getPyramidFactor() == 4);
+    UNIT_TEST(areEqual(patternPhase.getPlane1().getA(), pyramidPhase.getPlane1().getA(), 1e-12));
+    UNIT_TEST(areEqual(patternPhase.getPlane2().getC(), pyramidPhase.getPlane2().getC(), 1e-12));
+    UNIT_TEST(countAllocations([&]() { pyramidPhase.compute(array); }) == 0);
+    std::vector<Eigen::ArrayXXcd> snapshots = renderSnapshots();
+    PatternPhase snapshotPhase;
+    pyramidPhase.setSigma(snapshotPhase.getSigma());
+    pyramidPhase.compute(snapshots[1]);
+    snapshotPhase.compute(snapshots[1]);
+    UNIT_TEST(areEqual(snapshotPhase.getPlane1().getA(), pyramidPhase.getPlane1().getA(), 1e-12));
+    UNIT_TEST(areEqual(snapshotPhase.getPlane2().getC(), pyramidPhase.getPlane2().getC(), 1e-12));
 }
 
 void runAllTests2() {
@@ -139,9 +500,228 @@ double speed(unsigned long testCount) {
     return toc(testCount);
 }
 
+/** Computing time of the phase retrieving of 50 snapshots computed as a batch or one by one */
+double speedBatch(bool batch, unsigned long testCount) {
+
+    double period = 10.0;
+    PeriodicPatternLayout layout(period, 81, 81);
+    Eigen::ArrayXXd snapshot(128, 128);
+    std::vector<Eigen::ArrayXXcd> snapshots(50, Eigen::ArrayXXcd::Zero(128, 128));
+    for (int i = 0; i < (int) snapshots.size(); i++) {
+        layout.renderOrthographicProjection(Pose(0.1 * i, 0.2 * i, 0.05 * i, 1.0), snapshot);
+        snapshots[i].real() = snapshot;
+    }
+
+    PatternPhase phaseRetrieving(128, 128);
+    phaseRetrieving.computeBatch(snapshots);
+
+    tic();
+    for (unsigned long i = 0; i < testCount; i++) {
+        if (batch) {
+            phaseRetrieving.computeBatch(snapshots);
+        } else {
+            for (int j = 0; j < (int) snapshots.size(); j++) {
+                phaseRetrieving.compute(snapshots[j]);
+            }
+        }
+    }
+    return toc(testCount);
+}
+
+/** Computing time of the phase retrieving of a large image with a given number of threads */
+double speedThreads(int nThreads, unsigned long testCount) {
+
+    int size = 4096;
+    double period = 12.0;
+    PeriodicPatternLayout layout(period, 2 * (size / 12) + 1, 2 * (size / 12) + 1);
+
+    Eigen::ArrayXXd array(size, size);
+    layout.renderOrthographicProjection(Pose(0.0, 0.0, 1000, 0.2, 0.0, 0.0, 1.0), array);
+
+    PatternPhase phaseRetrieving(size, size);
+    phaseRetrieving.setNumberOfThreads(nThreads);
+    phaseRetrieving.compute(array);
+
+    tic();
+    for (unsigned long i = 0; i < testCount; i++) {
+        phaseRetrieving.compute(array);
+    }
+    return toc(testCount);
+}
+
+/** Computing time per image of the phase retrieving along the recorded 
+ * Image140 sequence, with or without the tracking of the peaks, once the 
+ * transforms are planned on the first image */
+double speedTracking(bool tracking) {
+
+    PatternPhase phaseRetrieving;
+    phaseRetrieving.compute(image2array(cv::imread("data/Image140/Image96.png", 0)));
+    phaseRetrieving.setTracking(tracking);
+
+    int imageCount = 0;
+    double totalTime = 0.0;
+    for (int i = 96; i <= 133; i++) {
+        cv::Mat image = cv::imread("data/Image140/Image" + to_string(i) + ".png", 0);
+        Eigen::ArrayXXd array = image2array(image);
+        tic();
+        phaseRetrieving.compute(array);
+        totalTime += toc(1);
+        imageCount++;
+    }
+    return totalTime / imageCount;
+}
+
+/** Computing time of the phase retrieving of the megarena image tiled on a 
+ * size x size frame, with a global or a coarse-to-fine peaks search */
+double speedPyramid(int pyramidFactor, int size, unsigned long testCount) {
+
+    cv::Mat image = cv::imread("data/megarena/megarena.png", 0);
+    Eigen::ArrayXXd tile = image2array(image);
+    Eigen::ArrayXXd array = tile.replicate(size / tile.rows() + 1, size / tile.cols() + 1).topLeftCorner(size, size);
+
+    PatternPhase phaseRetrieving(size, size);
+    phaseRetrieving.setPyramidFactor(pyramidFactor);
+    phaseRetrieving.compute(array);
+
+    tic();
+    for (unsigned long i = 0; i < testCount; i++) {
+        phaseRetrieving.compute(array);
+    }
+    return toc(testCount);
+}
+
+/** Phase planes (a, b, c of both directions) of the two HP codes in each image
+ * of the Image140 sequence, computed in 512 x 512 windows around the codes 
+ * like the snapshots of HPCodePatternDetector, and mean computing time */
+std::vector<Eigen::VectorXd> computeImage140Planes(double& meanTime) {
+    const int centers[2][2] = {{940, 640}, {972, 1316}}; // (row, col) of the codes
+    PatternPhase phaseRetrieving(512, 512);
+    std::vector<Eigen::VectorXd> planes;
+    double totalTime = 0.0;
+    for (int i = 96; i <= 133; i++) {
+        cv::Mat image = cv::imread("data/Image140/Image" + to_string(i) + ".png", 0);
+        Eigen::ArrayXXd array = image2array(image);
+        for (int code = 0; code < 2; code++) {
+            Eigen::ArrayXXd snapshot = array.block(centers[code][0] - 256, centers[code][1] - 256, 512, 512);
+            tic();
+            phaseRetrieving.compute(snapshot);
+            totalTime += toc(1);
+            PhasePlane plane1 = phaseRetrieving.getPlane1();
+            PhasePlane plane2 = phaseRetrieving.getPlane2();
+            Eigen::VectorXd values(8);
+            values << i, code, plane1.getA(), plane1.getB(), plane1.getC(), plane2.getA(), plane2.getB(), plane2.getC();
+            planes.push_back(values);
+        }
+    }
+    meanTime = totalTime / planes.size();
+    return planes;
+}
+
+/** Writes the reference phase planes of the Image140 sequence (to be run with
+ * the double precision build, the file is kept in test/data/Image140) */
+void writeImage140Reference() {
+    double meanTime;
+    std::vector<Eigen::VectorXd> planes = computeImage140Planes(meanTime);
+    ofstream file("data/Image140/phasePlanes.csv");
+    file << "image;code;a1;b1;c1;a2;b2;c2;" << endl;
+    file << setprecision(17);
+    for (int k = 0; k < (int) planes.size(); k++) {
+        for (int j = 0; j < planes[k].size(); j++) {
+            file << planes[k](j) << ";";
+        }
+        file << endl;
+    }
+}
+
+/** Compares the phase planes of the Image140 sequence with the double 
+ * precision reference and measures the computing time per HP code. Run it 
+ * with the USE_FLOAT build and with the default build to compare the accuracy
+ * and latency of both precisions. The deviations are given at the center of 
+ * the windows, in pixels for the positions and in radians for the angles. */
+void compareImage140Precision() {
+    ifstream file("data/Image140/phasePlanes.csv");
+    string line;
+    getline(file, line);
+    std::vector<Eigen::VectorXd> reference;
+    while (getline(file, line)) {
+        stringstream lineStream(line);
+        string value;
+        Eigen::VectorXd values(8);
+        for (int j = 0; j < 8 && getline(lineStream, value, ';'); j++) {
+            values(j) = stod(value);
+        }
+        reference.push_back(values);
+    }
+
+    double meanTime;
+    std::vector<Eigen::VectorXd> planes = computeImage140Planes(meanTime);
+    double meanPositionDeviation = 0.0, maxPositionDeviation = 0.0;
+    double meanAngleDeviation = 0.0, maxAngleDeviation = 0.0;
+    int count = 0;
+    for (int k = 0; k < (int) std::min(planes.size(), reference.size()); k++) {
+        for (int d = 0; d < 2; d++) {
+            double a = planes[k](2 + 3 * d), b = planes[k](3 + 3 * d), c = planes[k](4 + 3 * d);
+            double aRef = reference[k](2 + 3 * d), bRef = reference[k](3 + 3 * d), cRef = reference[k](4 + 3 * d);
+            double phaseDeviation = angleInPiPi((a - aRef) * 256.0 + (b - bRef) * 256.0 + c - cRef);
+            double positionDeviation = std::abs(phaseDeviation) / std::sqrt(aRef * aRef + bRef * bRef);
+            double angleDeviation = std::abs(angleInPiPi(std::atan2(b, a) - std::atan2(bRef, aRef)));
+            meanPositionDeviation += positionDeviation;
+            meanAngleDeviation += angleDeviation;
+            maxPositionDeviation = std::max(maxPositionDeviation, positionDeviation);
+            maxAngleDeviation = std::max(maxAngleDeviation, angleDeviation);
+            count++;
+        }
+    }
+
+    cout << "Phase computation in " << (sizeof (Real) == sizeof (float) ? "single" : "double") << " precision" << endl;
+    cout << "Mean computing time per HP code: " << meanTime << " ms" << endl;
+    cout << "Planes compared with the double precision reference: " << count << endl;
+    if (count > 0) {
+        cout << "Position deviation (mean / max): " << meanPositionDeviation / count << " / " << maxPositionDeviation << " pixels" << endl;
+        cout << "Angle deviation (mean / max): " << meanAngleDeviation / count << " / " << maxAngleDeviation << " rad" << endl;
+    }
+}
+
 int main(int argc, char** argv) {
 
-    runAllTests();
+#ifdef __GLIBC__
+    // Measured plans may use the buffered codelets of FFTW, which allocate at 
+    // each execution: the allocation counts need the estimated plans
+    setenv("VERNIER_FFTW_PLANNER", "estimate", 0);
+#endif
+
+    testPhasePlanes();
+    testBatch();
+    testDecimation();
+    testTracking();
+    testCenteredSpectra();
+    testUnwrapFree();
+    testThreads();
+    testComputeFirst();
+    testPhaseGradients();
+    testAnnulus();
+    testFastMode();
+    testPyramid();
+
+    //    cout << "50 snapshots one by one: " << speedBatch(false, 10) << " ms, as a batch: " << speedBatch(true, 10) << " ms" << endl;
+
+    // Benchmarks, run on demand: TestPatternPhase speed [maximal number of threads]
+    if (argc > 1 && string(argv[1]) == "speed") {
+        int maxThreads = (argc > 2) ? atoi(argv[2]) : std::max(1, (int) std::thread::hardware_concurrency());
+        double time1 = 0.0;
+        for (int nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+            double time = speedThreads(nThreads, 10);
+            time1 = (nThreads == 1) ? time : time1;
+            cout << "4096 pixels, " << nThreads << " threads: " << time << " ms (speed-up " << time1 / time << ")" << endl;
+        }
+        cout << "Image140 sequence: " << speedTracking(false) << " ms per image, with tracking: " << speedTracking(true) << " ms per image" << endl;
+    }
+
+    //    compareImage140Precision();
+
+    //    for (int size = 512; size <= 8192; size *= 2) {
+    //        cout << size << " pixels: " << speedPyramid(1, size, 10) << " ms, pyramid: " << speedPyramid(4, size, 10) << " ms" << endl;
+    //    }
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
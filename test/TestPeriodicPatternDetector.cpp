@@ -162,10 +162,51 @@ void test2d() {
     TEST_EQUALITY(patternPose, estimatedPose, 0.01)
 }
 
+void testFastMode() {
+    START_UNIT_TEST;
+
+    PeriodicPatternLayout layout(8.0, 81, 61);
+    Eigen::ArrayXXd array(256, 256);
+    layout.renderOrthographicProjection(Pose(1.0, 2.0, 0.3, 1.0), array);
+    PeriodicPatternDetector detector(8.0);
+    detector.computeArray(array);
+    Pose pose = detector.get2DPose();
+
+    // The fast mode gives the pose within a hundredth of the period
+    detector.setFastMode(true);
+    detector.computeArray(array);
+    TEST_EQUALITY(pose, detector.get2DPose(), 0.01);
+
+    // The phase gradients, which need the phase maps, are refused in the fast
+    // mode, in both orders, and the detector keeps computing the poses
+    bool gradientsRefused = false;
+    try {
+        detector.setPhaseGradientMode(false);
+    } catch (Exception&) {
+        gradientsRefused = true;
+    }
+    UNIT_TEST(gradientsRefused && !detector.isPhaseGradientMode());
+    detector.computeArray(array);
+    TEST_EQUALITY(pose, detector.get2DPose(), 0.01);
+    detector.setFastMode(false);
+    detector.setPhaseGradientMode(false);
+    bool fastModeRefused = false;
+    try {
+        detector.setBool("fastMode", true);
+    } catch (Exception&) {
+        fastModeRefused = true;
+    }
+    UNIT_TEST(fastModeRefused && !detector.getBool("fastMode"));
+    detector.computeArray(array);
+    TEST_EQUALITY(pose, detector.get2DPose(), 1e-12);
+}
+
 int main(int argc, char** argv) {
 
     //    main2d();
 
+    testFastMode();
+
     // REPEAT_TEST(test2d(), 10)
     test2d(); // Doing it only once before checking it later for a large number of random poses
 
@@ -77,6 +77,59 @@ void runAllTests() {
     file.read_mat("unwrapCenterMatlab", unwrappedReference);
 
     UNIT_TEST(areEqual(unwrappedReference, wrappedPhasePeak1));
+
+    // Modulated copy and argument are the same as shift on a copy
+    Eigen::ArrayXXcd array = Eigen::ArrayXXcd::Random(6, 8);
+    Eigen::ArrayXXcd shifted = array;
+    Spatial::shift(shifted);
+    Eigen::ArrayXXcf modulated(6, 8);
+    Spatial::shift(array, modulated);
+    Eigen::ArrayXXcf shiftedFloat = shifted.cast<std::complex<float> >();
+    UNIT_TEST(areEqual(shiftedFloat, modulated, 1e-6));
+
+    Eigen::ArrayXXd phase;
+    Spatial::shiftedArg(array, phase);
+    Eigen::ArrayXXd shiftedPhase = shifted.arg();
+    UNIT_TEST(areEqual(shiftedPhase, phase));
+
+    // The threaded unwrapping gives exactly the same phase
+    Eigen::ArrayXXd noisyPhase = Eigen::ArrayXXd::Random(95, 130) * PI;
+    Eigen::ArrayXXd unwrappedSerial = noisyPhase;
+    Spatial::quartersUnwrapPhase(unwrappedSerial);
+    UnwrapBuffers buffers;
+    ThreadPool threadPool;
+    for (int nThreads = 2; nThreads <= 5; nThreads++) {
+        threadPool.setNumberOfThreads(nThreads);
+        // The workers of the pool are reused by the next maps
+        for (int i = 0; i < 2; i++) {
+            Eigen::ArrayXXd unwrappedThreaded = noisyPhase;
+            Spatial::quartersUnwrapPhase(unwrappedThreaded, buffers, threadPool);
+            UNIT_TEST((unwrappedThreaded == unwrappedSerial).all());
+        }
+    }
+
+    // The unwrapping fed to the regression gives the plane of the unwrapped map
+    Eigen::ArrayXXcd field(94, 130);
+    for (int col = 0; col < field.cols(); col++) {
+        for (int row = 0; row < field.rows(); row++) {
+            field(row, col) = std::polar(1.0 + 0.1 * row, 0.7 * col - 0.4 * row + 0.5 * noisyPhase(row, col));
+        }
+    }
+    for (bool shifted : {false, true}) {
+        Eigen::ArrayXXd unwrappedPhase = field.arg();
+        if (shifted) {
+            Spatial::shiftedArg(field, unwrappedPhase);
+        }
+        Spatial::quartersUnwrapPhase(unwrappedPhase);
+        RegressionPlane regressionPlane(0.3);
+        PhasePlane expected = regressionPlane.compute(unwrappedPhase);
+        for (int nThreads = 1; nThreads <= 4; nThreads++) {
+            threadPool.setNumberOfThreads(nThreads);
+            Spatial::quartersUnwrapPhase(field, shifted, regressionPlane, buffers, threadPool);
+            PhasePlane plane = regressionPlane.computeAccumulated();
+            UNIT_TEST(plane.getA() == expected.getA() && plane.getB() == expected.getB() && plane.getC() == expected.getC());
+        }
+    }
 }
 
 /* Runs a given amount of times the unwrapping function
@@ -97,6 +150,29 @@ double speed(unsigned long testCount) {
     return toc(testCount);
 }
 
+/** Computing time of the unwrapping of a size x size phase map with a given number of threads */
+double speedThreads(int size, int nThreads, unsigned long testCount) {
+    Eigen::ArrayXXd wrappedPhase(size, size);
+    for (int col = 0; col < size; col++) {
+        for (int row = 0; row < size; row++) {
+            wrappedPhase(row, col) = std::arg(std::polar(1.0, 0.5 * col - 0.3 * row));
+        }
+    }
+    Eigen::ArrayXXd phase = wrappedPhase;
+    UnwrapBuffers buffers;
+    ThreadPool threadPool(nThreads);
+    Spatial::quartersUnwrapPhase(phase, buffers, threadPool);
+
+    double time = 0.0;
+    for (unsigned long i = 0; i < testCount; i++) {
+        phase = wrappedPhase;
+        tic();
+        Spatial::quartersUnwrapPhase(phase, buffers, threadPool);
+        time += toc(1);
+    }
+    return time / testCount;
+}
+
 double speed2(unsigned long testCount) {
     Eigen::ArrayXXcd in = Eigen::ArrayXXcd::Random(1024, 768);
 
@@ -112,5 +188,18 @@ int main(int argc, char** argv) {
 
     runAllTests();
 
+    // Benchmarks, run on demand: TestSpatial speed [maximal number of threads]
+    if (argc > 1 && string(argv[1]) == "speed") {
+        int maxThreads = (argc > 2) ? atoi(argv[2]) : std::max(1, (int) std::thread::hardware_concurrency());
+        for (int size : {2048, 4096}) {
+            double time1 = 0.0;
+            for (int nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+                double time = speedThreads(size, nThreads, 10);
+                time1 = (nThreads == 1) ? time : time1;
+                cout << size << "x" << size << ", " << nThreads << " threads: " << time << " ms (speed-up " << time1 / time << ")" << endl;
+            }
+        }
+    }
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
  */
 
 #include "Spectrum.hpp"
+#include "FourierTransform.hpp"
+#include "PeriodicPatternLayout.hpp"
 #include "eigen-matio/MatioFile.hpp"
 #include "UnitTest.hpp"
 
@@ -87,6 +89,236 @@ void test2() {
     UNIT_TEST(areEqual(mainPeak2(1), mainPeakRef2(0) - 1));
 }
 
+void test3() {
+
+    START_UNIT_TEST;
+    Eigen::ArrayXXcd spectrum = 0.1 * Eigen::ArrayXXcd::Random(128, 160);
+    spectrum.block(79, 99, 3, 3) = 25;
+    spectrum(80, 100) = 50;
+    spectrum.block(89, 69, 3, 3) = 10;
+    spectrum(90, 70) = 20;
+    spectrum.block(60, 76, 8, 8) = 1000; // central peak, excluded of the search
+    Eigen::ArrayXXcd spectrumCopy = spectrum;
+
+    Eigen::ArrayXXd magnitude;
+    Eigen::Vector3d mainPeak1, mainPeak2;
+    Spectrum::mainPeakHalfPlane(spectrum, magnitude, mainPeak1, mainPeak2);
+    UNIT_TEST(mainPeak1.x() == 100 && mainPeak1.y() == 80);
+    UNIT_TEST(mainPeak2.x() == 70 && mainPeak2.y() == 90);
+    UNIT_TEST((spectrum == spectrumCopy).all());
+}
+
+void test4() {
+
+    START_UNIT_TEST;
+    Eigen::ArrayXXcd spectrum = 0.1 * Eigen::ArrayXXcd::Random(128, 160);
+    spectrum.block(79, 99, 3, 3) = 25; // period 5.7 pixels
+    spectrum(80, 100) = 50;
+    spectrum.block(89, 69, 3, 3) = 10; // period 4.7 pixels
+    spectrum(90, 70) = 20;
+    spectrum.block(69, 129, 3, 3) = 100; // period 3.2 pixels, out of the annulus
+    spectrum(70, 130) = 200;
+
+    std::vector<int> annulus;
+    Spectrum::annulusIndices(128, 160, 4.0, 7.0, annulus);
+    UNIT_TEST(annulus.size() < 0.2 * 128 * 160 / 2);
+
+    Eigen::Vector3d mainPeak1, mainPeak2;
+    Spectrum::mainPeakAnnulus(spectrum, annulus, mainPeak1, mainPeak2);
+    UNIT_TEST(mainPeak1.x() == 100 && mainPeak1.y() == 80);
+    UNIT_TEST(mainPeak2.x() == 70 && mainPeak2.y() == 90);
+
+    Spectrum::mainPeakHalfPlane(spectrum, mainPeak1, mainPeak2);
+    UNIT_TEST(mainPeak1.x() == 130 && mainPeak1.y() == 70);
+}
+
+void test5() {
+
+    START_UNIT_TEST;
+    PeriodicPatternLayout layout(10.0, 81, 81);
+    Eigen::ArrayXXd image(256, 256);
+    layout.renderOrthographicProjection(Pose(4.0, 3.0, 0.2, 1.0), image);
+    Eigen::ArrayXXcd spatial = image.cast<std::complex<double> >();
+    Eigen::ArrayXXcd spectrum, spectrumShifted;
+    BasicFourierTransform<double> fft(256, 256, FFTW_FORWARD);
+    fft.compute(spatial, spectrum);
+    Spectrum::shift(spectrum, spectrumShifted);
+    Eigen::ArrayXXcd spectrumCopy = spectrumShifted;
+
+    // The local maxima searches give the peaks of the half plane search, 
+    // without modifying the spectrum
+    Eigen::Vector3d mainPeak1, mainPeak2, perimeterPeak1, perimeterPeak2, energyPeak1, energyPeak2;
+    Spectrum::mainPeakHalfPlane(spectrumShifted, mainPeak1, mainPeak2);
+    Spectrum::mainPeakPerimeter(spectrumShifted, perimeterPeak1, perimeterPeak2);
+    Spectrum::mainPeak4Search(spectrumShifted, energyPeak1, energyPeak2);
+    UNIT_TEST(perimeterPeak1.head<2>() == mainPeak1.head<2>() && perimeterPeak2.head<2>() == mainPeak2.head<2>());
+    UNIT_TEST(energyPeak1.head<2>() == mainPeak1.head<2>() && energyPeak2.head<2>() == mainPeak2.head<2>());
+    UNIT_TEST((spectrumShifted == spectrumCopy).all());
+}
+
+void test6() {
+
+    START_UNIT_TEST;
+    PeriodicPatternLayout layout(10.0, 81, 81);
+    Eigen::ArrayXXd image(256, 256);
+    layout.renderOrthographicProjection(Pose(4.0, 3.0, 0.2, 1.0), image);
+    Eigen::ArrayXXcd spatial = image.cast<std::complex<double> >();
+    Eigen::ArrayXXcd spectrum, spectrumShifted;
+    BasicFourierTransform<double> fft(256, 256, FFTW_FORWARD);
+    fft.compute(spatial, spectrum);
+    Spectrum::shift(spectrum, spectrumShifted);
+
+    // The refined peaks lie between the bins, at 25.6 bins from the center
+    Eigen::Vector3d mainPeak1, mainPeak2;
+    Spectrum::mainPeakHalfPlane(spectrumShifted, mainPeak1, mainPeak2);
+    Spectrum::refinePeak(spectrumShifted, mainPeak1);
+    Spectrum::refinePeak(spectrumShifted, mainPeak2);
+    UNIT_TEST(areEqual(std::hypot(mainPeak1.x() - 128, mainPeak1.y() - 128), 25.6, 0.01));
+    UNIT_TEST(areEqual(std::hypot(mainPeak2.x() - 128, mainPeak2.y() - 128), 25.6, 0.01));
+
+    // The planes at the refined frequencies have the period of the pattern
+    PhasePlane plane1 = Spectrum::peakPlane(image, mainPeak1);
+    PhasePlane plane2 = Spectrum::peakPlane(spatial, mainPeak2);
+    UNIT_TEST(areEqual(plane1.getPixelicPeriod(), 10.0, 0.01));
+    UNIT_TEST(areEqual(plane2.getPixelicPeriod(), 10.0, 0.01));
+    UNIT_TEST(areEqual(plane1.getC(), Spectrum::peakPlane(spatial, mainPeak1).getC(), 1e-9));
+}
+
+/** Former iterative search of mainPeakPerimeter() and mainPeak4Search(): 
+ * nPeaks times, the maximum of the power is taken and an 8x8 block around it 
+ * is zeroed (the center square is zeroed first). Each row of the list holds 
+ * the column, the row, the angle and the 2x2 magnitude sum of a peak. */
+Eigen::ArrayXXd formerPeakList(Eigen::ArrayXXcd source, int nPeaks) {
+    int offsetMin = source.rows() / 100.0;
+    source.block(source.rows() / 2 - offsetMin / 2, source.cols() / 2 - offsetMin / 2, offsetMin, offsetMin) = 0;
+    Eigen::ArrayXXd peakList(nPeaks, 4);
+    for (int i = 0; i < nPeaks; i++) {
+        double maxValue = 0;
+        for (int col = 0; col < source.cols(); col++) {
+            for (int row = 0; row < source.rows(); row++) {
+                double norm = std::norm(source(row, col));
+                if (norm > maxValue) {
+                    maxValue = norm;
+                    peakList(i, 0) = col;
+                    peakList(i, 1) = row;
+                    peakList(i, 2) = atan2(row - source.rows() / 2, col - source.cols() / 2);
+                }
+            }
+        }
+        int col = peakList(i, 0);
+        int row = peakList(i, 1);
+        peakList(i, 3) = 0;
+        if (row - 1 > 0 && col - 1 > 0 && row + 1 < source.rows() && col + 1 < source.cols()) {
+            peakList(i, 3) = source.block(row - 1, col - 1, 2, 2).abs().sum();
+        }
+        if (row - 4 > 0 && col - 4 > 0 && row + 4 < source.rows() && col + 4 < source.cols()) {
+            source.block(row - 4, col - 4, 8, 8) = 0;
+        } else {
+            source(row, col) = 0;
+        }
+    }
+    return peakList;
+}
+
+/** Rows of the list sorted by increasing values of a column (first one kept on ties) */
+Eigen::ArrayXXd sortedRows(const Eigen::ArrayXXd& list, int column) {
+    std::vector<int> order(list.rows());
+    for (int i = 0; i < (int) order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int i, int j) {
+        return list(i, column) < list(j, column);
+    });
+    Eigen::ArrayXXd sorted(list.rows(), list.cols());
+    for (int i = 0; i < (int) order.size(); i++) {
+        sorted.row(i) = list.row(order[i]);
+    }
+    return sorted;
+}
+
+/** Peaks of the former mainPeakPerimeter() */
+void formerPeakPerimeter(const Eigen::ArrayXXcd& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
+    Eigen::ArrayXXd peakList = sortedRows(formerPeakList(source, 8), 2);
+    double dist1 = 0;
+    double dist2 = 0;
+    for (int i = 0; i < peakList.rows() / 2 - 1; i++) {
+        dist1 += Spectrum::getDistancePoints(peakList(2 * i, 0), peakList(2 * i, 1), peakList(2 * (i + 1), 0), peakList(2 * (i + 1), 1));
+        dist2 += Spectrum::getDistancePoints(peakList(2 * i + 1, 0), peakList(2 * i + 1, 1), peakList(2 * (i + 1) + 1, 0), peakList(2 * (i + 1) + 1, 1));
+    }
+    int first = (dist1 < dist2) ? 4 : 3;
+    mainPeak1 << peakList(first, 0), peakList(first, 1), 0;
+    mainPeak2 << peakList(first + 2, 0), peakList(first + 2, 1), 0;
+}
+
+/** Peaks of the former mainPeak4Search() */
+void formerPeak4Search(const Eigen::ArrayXXcd& source, Eigen::Vector3d& mainPeak1, Eigen::Vector3d& mainPeak2) {
+    Eigen::ArrayXXd peakList = formerPeakList(source, 10);
+    peakList.col(3) = -peakList.col(3);
+    peakList = sortedRows(sortedRows(peakList, 3).topRows(4), 2);
+    int first = (peakList(3, 2) > 7.0 * PI / 8.0) ? 1 : 2;
+    mainPeak1 << peakList(first, 0), peakList(first, 1), 0;
+    mainPeak2 << peakList(first + 1, 0), peakList(first + 1, 1), 0;
+}
+
+void test7() {
+
+    START_UNIT_TEST;
+    // Rendered patterns, and noise whose peaks are not local maxima once the 
+    // blocks of the larger peaks are zeroed
+    std::vector<Eigen::ArrayXXcd> spectra;
+    for (int i = 0; i < 6; i++) {
+        PeriodicPatternLayout layout(6.0 + 3.0 * i, 81, 81);
+        Eigen::ArrayXXd image(128 + 64 * (i % 2), 256);
+        layout.renderOrthographicProjection(Pose(4.0 + i, 3.0, 0.3 * i - 0.8, 1.0), image);
+        Eigen::ArrayXXcd spatial = image.cast<std::complex<double> >();
+        Eigen::ArrayXXcd spectrum, spectrumShifted;
+        BasicFourierTransform<double> fft(image.rows(), image.cols(), FFTW_FORWARD);
+        fft.compute(spatial, spectrum);
+        Spectrum::shift(spectrum, spectrumShifted);
+        spectra.push_back(spectrumShifted);
+    }
+    for (int i = 0; i < 6; i++) {
+        spectra.push_back(Eigen::ArrayXXcd::Random(100 + 20 * i, 140));
+    }
+    Eigen::ArrayXXcd plateaus = Eigen::ArrayXXcd::Zero(120, 120);
+    plateaus.block(20, 30, 12, 12) = 2; // larger than the zeroed blocks
+    plateaus.block(80, 70, 3, 3) = 2;
+    plateaus.block(90, 20, 20, 5) = 1;
+    spectra.push_back(plateaus);
+
+    for (const Eigen::ArrayXXcd& spectrum : spectra) {
+        Eigen::Vector3d peak1, peak2, formerPeak1, formerPeak2;
+        Spectrum::mainPeakPerimeter(spectrum, peak1, peak2);
+        formerPeakPerimeter(spectrum, formerPeak1, formerPeak2);
+        UNIT_TEST(peak1.head<2>() == formerPeak1.head<2>() && peak2.head<2>() == formerPeak2.head<2>());
+        Spectrum::mainPeak4Search(spectrum, peak1, peak2);
+        formerPeak4Search(spectrum, formerPeak1, formerPeak2);
+        UNIT_TEST(peak1.head<2>() == formerPeak1.head<2>() && peak2.head<2>() == formerPeak2.head<2>());
+    }
+
+    // Too few peaks: the missing ones are at the center instead of undefined
+    Eigen::ArrayXXcd sparse = Eigen::ArrayXXcd::Zero(64, 64);
+    sparse(20, 40) = 1;
+    Eigen::Vector3d peak1, peak2;
+    Spectrum::mainPeakPerimeter(sparse, peak1, peak2);
+    UNIT_TEST((peak1.x() == 32 && peak1.y() == 32) || (peak2.x() == 32 && peak2.y() == 32));
+}
+
+/** Computing time of the half plane peaks search of a size x size spectrum */
+double speedPeaksHalfPlane(int size, unsigned long testCount) {
+    Eigen::ArrayXXcd spectrum = Eigen::ArrayXXcd::Random(size, size);
+    Eigen::ArrayXXd magnitude;
+    Eigen::Vector3d mainPeak1, mainPeak2;
+    Spectrum::mainPeakHalfPlane(spectrum, magnitude, mainPeak1, mainPeak2);
+
+    tic();
+    for (unsigned long i = 0; i < testCount; i++) {
+        Spectrum::mainPeakHalfPlane(spectrum, magnitude, mainPeak1, mainPeak2);
+    }
+
+    return toc(testCount);
+}
+
 double speedShift(unsigned long testCount) {
     Eigen::ArrayXXcd spatial = Eigen::ArrayXXcd::Random(1024, 1024);
     Eigen::ArrayXXcd spectral(spatial);
@@ -163,6 +395,18 @@ int main(int argc, char** argv) {
 
     test1();
     test2();
+    test3();
+    test4();
+    test5();
+    test6();
+    test7();
+
+    // Benchmarks, run on demand: TestSpectrum speed
+    if (argc > 1 && std::string(argv[1]) == "speed") {
+        for (int size = 1024; size <= 4096; size *= 2) {
+            std::cout << size << " pixels, half plane peaks search: " << speedPeaksHalfPlane(size, 10) << " ms" << std::endl;
+        }
+    }
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file